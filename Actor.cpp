@@ -6,8 +6,8 @@ using namespace std;
 
 // Actor implementation
 
-Actor::Actor(StudentWorld* myWorld, int imageID, double x, double y, Direction dir = 0, int depth = 0, double size = 1.0)
-: GraphObject(imageID, x, y, dir, depth, size), world(myWorld), alive(true)
+Actor::Actor(StudentWorld* myWorld, int imageID, Coord x, Coord y, Direction dir = 0, int depth = 0, double size = 1.0)
+: GraphObject(myWorld->getScene(), imageID, x, y, dir, depth, size), world(myWorld), alive(true), slot(-1), typeSlot(-1)
 {}
 
 // default implementation to be changed by applicable actors
@@ -32,44 +32,77 @@ bool Actor::canBlockFlame() const { return false; }
 
 bool Actor::threatensCitizens() const { return false; }
 
+bool Actor::activatesOnContact() const { return false; }
+
+bool Actor::triggersContacts() const { return false; }
+
+void Actor::timerExpired() { return; }
+
+int Actor::getTickPeriod() const { return 1; }
+
+void Actor::decide() { return; }
+
+void Actor::commit() { doSomething(); }
+
 bool Actor::isAlive() const { return alive; }
 
-void Actor::setAlive(bool state) { alive = state; }
+void Actor::setAlive(bool state)
+{
+    if(alive && !state)
+        world->removeActor(this);
+    alive = state;
+}
 
 StudentWorld* Actor::getWorld() const { return world; }
 
+void Actor::moveTo(Coord x, Coord y)
+{
+    GraphObject::moveTo(x, y);
+    if(slot >= 0)
+        world->actorMoved(this);
+}
+
+int Actor::getSlot() const { return slot; }
+
+void Actor::setSlot(int s) { slot = s; }
+
+int Actor::getTypeSlot() const { return typeSlot; }
+
+void Actor::setTypeSlot(int s) { typeSlot = s; }
+
 // Wall implementation
 
-Wall::Wall(StudentWorld* myWorld, double x, double y)
+Wall::Wall(StudentWorld* myWorld, Coord x, Coord y)
 : Actor(myWorld, IID_WALL, x, y, right, 0)
-{}
+{
+    setStatic();
+}
 
 void Wall::doSomething() { return; }
 
+int Wall::getTickPeriod() const { return 0; }
+
 bool Wall::canBlockMovement() const { return true; }
 
 bool Wall::canBlockFlame() const { return true; }
 
 // ActivatingObject implementation
 
-ActivatingObject::ActivatingObject(StudentWorld* myWorld, int imageID, double x, double y, int depth, int dir)
+ActivatingObject::ActivatingObject(StudentWorld* myWorld, int imageID, Coord x, Coord y, int depth, int dir)
 : Actor(myWorld, imageID, x, y, depth, dir)
 {}
 
 // Exit implementation
 
-Exit::Exit(StudentWorld* myWorld, double x, double y)
+Exit::Exit(StudentWorld* myWorld, Coord x, Coord y)
 : ActivatingObject(myWorld, IID_EXIT, x, y, right, 1)
-{}
-
-void Exit::doSomething()
 {
-    if(!isAlive())
-        return;
-    
-    getWorld()->activateOnAppropriateActors(this);
+    setStatic();
 }
 
+// exits are activated by StudentWorld when agents overlap them
+void Exit::doSomething() { return; }
+
 // allows appropriate actors to exit
 void Exit::activateIfAppropriate(Actor* a)
 {
@@ -78,20 +111,21 @@ void Exit::activateIfAppropriate(Actor* a)
 
 bool Exit::canBlockFlame() const { return true; }
 
+bool Exit::activatesOnContact() const { return true; }
+
+int Exit::getTickPeriod() const { return 0; }
+
 // Pit implementation
 
-Pit::Pit(StudentWorld* myWorld, double x, double y)
+Pit::Pit(StudentWorld* myWorld, Coord x, Coord y)
 : ActivatingObject(myWorld, IID_PIT, x, y, right, 0)
-{}
-
-void Pit::doSomething()
 {
-    if(!isAlive())
-        return;
-    
-    getWorld()->activateOnAppropriateActors(this);
+    setStatic();
 }
 
+// pits are activated by StudentWorld when actors overlap them
+void Pit::doSomething() { return; }
+
 // kills appropriate actors
 void Pit::activateIfAppropriate(Actor* a)
 {
@@ -99,31 +133,26 @@ void Pit::activateIfAppropriate(Actor* a)
         a->dieByFallOrBurnIfAppropriate();
 }
 
-// Flame implementation
+bool Pit::activatesOnContact() const { return true; }
 
-Flame::Flame(StudentWorld* myWorld, double x, double y, int dir)
-: ActivatingObject(myWorld, IID_FLAME, x, y, dir, 0), ticks(0)
-{}
+int Pit::getTickPeriod() const { return 0; }
 
-void Flame::doSomething()
+// Flame implementation
+
+Flame::Flame(StudentWorld* myWorld, Coord x, Coord y, int dir)
+: ActivatingObject(myWorld, IID_FLAME, x, y, dir, 0)
 {
-    if(!isAlive())
-        return;
-    
-    // flames last for two ticks
-    if(ticks > 2)
-    {
-        setAlive(false);
-        return;
-    }
-    
-    if(isAlive())
-    {
-        getWorld()->activateOnAppropriateActors(this);
-        ticks++;
-    }
+    // flames burn this tick and the next two
+    myWorld->scheduleTimer(expireTimer, this, myWorld->getCurrentTick() + 3);
 }
 
+// StudentWorld burns whatever overlaps the flame until its timer fires
+void Flame::doSomething() { return; }
+
+void Flame::timerExpired() { setAlive(false); }
+
+int Flame::getTickPeriod() const { return 0; }
+
 // kill appropriate actors
 void Flame::activateIfAppropriate(Actor* a)
 {
@@ -133,30 +162,20 @@ void Flame::activateIfAppropriate(Actor* a)
 
 // Vomit implementation
 
-Vomit::Vomit(StudentWorld* myWorld, double x, double y, int dir)
-: ActivatingObject(myWorld, IID_VOMIT, x, y, dir, 0), ticks(0)
-{}
-
-void Vomit::doSomething()
+Vomit::Vomit(StudentWorld* myWorld, Coord x, Coord y, int dir)
+: ActivatingObject(myWorld, IID_VOMIT, x, y, dir, 0)
 {
-    if(!isAlive())
-        return;
-    
-    // vomit lasts two ticks
-    if(ticks > 2)
-    {
-        setAlive(false);
-        return;
-    }
-    
-    if(isAlive())
-    {
-        getWorld()->activateOnAppropriateActors(this);
-        ticks++;
-    }
-    
+    // vomit infects this tick and the next two
+    myWorld->scheduleTimer(expireTimer, this, myWorld->getCurrentTick() + 3);
 }
 
+// StudentWorld infects whatever overlaps the vomit until its timer fires
+void Vomit::doSomething() { return; }
+
+void Vomit::timerExpired() { setAlive(false); }
+
+int Vomit::getTickPeriod() const { return 0; }
+
 // infects appropriate actors
 void Vomit::activateIfAppropriate(Actor* a)
 {
@@ -165,32 +184,32 @@ void Vomit::activateIfAppropriate(Actor* a)
 
 // Landmine implementation
 
-Landmine::Landmine(StudentWorld* myworld, double x, double y)
-: ActivatingObject(myworld, IID_LANDMINE, x, y, right, 1), safetyTicks(30)
-{}
-
-void Landmine::doSomething()
+Landmine::Landmine(StudentWorld* myworld, Coord x, Coord y)
+: ActivatingObject(myworld, IID_LANDMINE, x, y, right, 1), armed(false)
 {
-    if(!isAlive())
-        return;
-    
-    // only activates after safety ticks expire
-    if(safetyTicks > 0)
-    {
-        safetyTicks--;
-        return;
-    }
-    
-    getWorld()->activateOnAppropriateActors(this);
+    // only activates after 30 safety ticks
+    myworld->scheduleTimer(armTimer, this, myworld->getCurrentTick() + 30);
 }
 
+// armed by its timer and set off by StudentWorld's contact pass
+void Landmine::doSomething() { return; }
+
+void Landmine::timerExpired() { armed = true; }
+
+int Landmine::getTickPeriod() const { return 0; }
+
 // blows up appropriate actors
 void Landmine::activateIfAppropriate(Actor* a)
 {
+    if(!armed)
+        return;
+    
     if(a->triggersOnlyActiveLandmines())
         explode();
 }
 
+bool Landmine::activatesOnContact() const { return true; }
+
 // blows up
 void Landmine::dieByFallOrBurnIfAppropriate()
 {
@@ -218,17 +237,26 @@ void Landmine::explode()
         y-SPRITE_HEIGHT, y, y+SPRITE_HEIGHT
     };
     
+    Coord flameX[9];
+    Coord flameY[9];
+    int numFlames = 0;
+    
     for(int i = 0; i < 9; i++)              // generate flame at (x,y) and eight adjacent spots
     {
         if(!getWorld()->isFlameBlockedAt(newX[i], newY[i]))
-            getWorld()->addActor(new Flame(getWorld(), newX[i], newY[i], up));
+        {
+            flameX[numFlames] = newX[i];
+            flameY[numFlames] = newY[i];
+            numFlames++;
+        }
     }
+    getWorld()->addFlames(flameX, flameY, numFlames, up);
     getWorld()->addActor(new Pit(getWorld(), getX(), getY()));      // pit after explosion
 }
 
 // Goodie implementation
 
-Goodie::Goodie(StudentWorld* myWorld, int imageID, double x, double y)
+Goodie::Goodie(StudentWorld* myWorld, int imageID, Coord x, Coord y)
 : ActivatingObject(myWorld, imageID, x, y, right, 1)
 {}
 
@@ -242,18 +270,18 @@ void Goodie::dieByFallOrBurnIfAppropriate()
     setAlive(false);
 }
 
+bool Goodie::activatesOnContact() const { return true; }
+
+int Goodie::getTickPeriod() const { return 0; }
+
 // VaccineGoodie implementation
 
-VaccineGoodie::VaccineGoodie(StudentWorld* myworld, double x, double y)
+VaccineGoodie::VaccineGoodie(StudentWorld* myworld, Coord x, Coord y)
 : Goodie(myworld, IID_VACCINE_GOODIE, x, y)
 {}
 
-void VaccineGoodie::doSomething()
-{
-    if(!isAlive())
-        return;
-    getWorld()->activateOnAppropriateActors(this);
-}
+// picked up when StudentWorld finds Penelope overlapping it
+void VaccineGoodie::doSomething() { return; }
 
 // increase p's vaccine count
 void VaccineGoodie::pickUp(Penelope* p)
@@ -263,16 +291,12 @@ void VaccineGoodie::pickUp(Penelope* p)
 
 // GasCanGoodie implementation
 
-GasCanGoodie::GasCanGoodie(StudentWorld* myworld, double x, double y)
+GasCanGoodie::GasCanGoodie(StudentWorld* myworld, Coord x, Coord y)
 : Goodie(myworld, IID_GAS_CAN_GOODIE, x, y)
 {}
 
-void GasCanGoodie::doSomething()
-{
-    if(!isAlive())
-        return;
-    getWorld()->activateOnAppropriateActors(this);
-}
+// picked up when StudentWorld finds Penelope overlapping it
+void GasCanGoodie::doSomething() { return; }
 
 // increase p's flame count
 void GasCanGoodie::pickUp(Penelope* p)
@@ -282,16 +306,12 @@ void GasCanGoodie::pickUp(Penelope* p)
 
 // LandmineGoodie implementation
 
-LandmineGoodie::LandmineGoodie(StudentWorld* myworld, double x, double y)
+LandmineGoodie::LandmineGoodie(StudentWorld* myworld, Coord x, Coord y)
 : Goodie(myworld, IID_LANDMINE_GOODIE, x, y)
 {}
 
-void LandmineGoodie::doSomething()
-{
-    if(!isAlive())
-        return;
-    getWorld()->activateOnAppropriateActors(this);
-}
+// picked up when StudentWorld finds Penelope overlapping it
+void LandmineGoodie::doSomething() { return; }
 
 // increase p's mine count
 void LandmineGoodie::pickUp(Penelope* p)
@@ -301,37 +321,97 @@ void LandmineGoodie::pickUp(Penelope* p)
 
 // Agent implementation
 
-Agent::Agent(StudentWorld* myWorld, int imageID, double x, double y, int dir)
-: Actor(myWorld, imageID, x, y, dir)
+Agent::Agent(StudentWorld* myWorld, int imageID, Coord x, Coord y, int dir)
+: Actor(myWorld, imageID, x, y, dir), hasPlannedMove(false), plannedDir(dir),
+  plannedX(0), plannedY(0), randomState(myWorld->nextAgentSeed())
 {}
 
+void Agent::doSomething()
+{
+    if(!isAlive())
+        return;
+    
+    decide();
+    commit();
+}
+
+// moves as planned unless another agent stepped into the way first
+void Agent::commit()
+{
+    if(!hasPlannedMove)
+        return;
+    
+    hasPlannedMove = false;
+    if(!getWorld()->isAgentMovementBlockedAt(plannedX, plannedY, this))
+    {
+        setDirection(plannedDir);
+        moveTo(plannedX, plannedY);
+    }
+}
+
+void Agent::planMove(Direction dir, Coord x, Coord y)
+{
+    hasPlannedMove = true;
+    plannedDir = dir;
+    plannedX = x;
+    plannedY = y;
+}
+
+// splitmix64 step
+int Agent::randInt(int min, int max)
+{
+    if(max < min)
+        swap(max, min);
+    
+    randomState += 0x9E3779B97F4A7C15ULL;
+    unsigned long long z = randomState;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    z ^= z >> 31;
+    
+    unsigned long long range = static_cast<unsigned long long>(max) - min + 1;
+    return min + static_cast<int>(z % range);
+}
+
 bool Agent::canBlockMovement() const { return true; }
 
 bool Agent::triggersOnlyActiveLandmines() const { return true; }
 
+bool Agent::triggersContacts() const { return true; }
+
 // Person implementation
 
-Person::Person(StudentWorld* myWorld, int imageID, double x, double y)
-: Agent(myWorld, imageID, x, y, right), infectionCount(0)
+Person::Person(StudentWorld* myWorld, int imageID, Coord x, Coord y)
+: Agent(myWorld, imageID, x, y, right)
 {}
 
-// get infected
+// get infected; the infection timer fires when the count reaches 500,
+// and every further vomit brings that one tick closer
 void Person::beVomitedOnIfAppropriate()
 {
-    infectionCount++;
+    long long due;
+    if(infectionTimer.isScheduled())
+        due = infectionTimer.getDue() - 1;
+    else
+        due = getWorld()->getCurrentTick() + 499;
+    
+    getWorld()->scheduleTimer(infectionTimer, this, due);
 }
 
 bool Person::triggersZombieVomit() const { return true; }
 
-void Person::clearInfection() { infectionCount = 0; }
+void Person::clearInfection() { getWorld()->cancelTimer(infectionTimer); }
 
-int Person::getInfectionCount() const { return infectionCount; }
-
-int Person::incrementInfectionCount() { return infectionCount++; }
+int Person::getInfectionCount() const
+{
+    if(!infectionTimer.isScheduled())
+        return 0;
+    return 500 - static_cast<int>(infectionTimer.getDue() - getWorld()->getCurrentTick());
+}
 
 // Penelope implementation
 
-Penelope::Penelope(StudentWorld* myWorld, double x, double y)
+Penelope::Penelope(StudentWorld* myWorld, Coord x, Coord y)
 : Person(myWorld, IID_PLAYER, x, y), numFlames(0), numMines(0), numVaccines(0), exit(false)
 {}
 
@@ -340,18 +420,6 @@ void Penelope::doSomething()
     if(!isAlive())          // if Penelope is dead
         return;
     
-    if(getInfectionCount() > 0)        // if Penelope is infected
-    {
-        incrementInfectionCount();
-        
-        if(getInfectionCount() >= 500)
-        {
-            setAlive(false);
-            getWorld()->playSound(SOUND_PLAYER_DIE);
-            return;
-        }
-    }
-    
     int ch;
     if(getWorld()->getKey(ch))          // if user hits a key during tick
     {
@@ -404,6 +472,9 @@ void Penelope::doSomething()
                 {
                     int newX = getX();
                     int newY = getY();
+                    Coord flameX[3];
+                    Coord flameY[3];
+                    int count = 0;
                     
                     for(int i = 1; i <= 3; i++)
                     {
@@ -426,8 +497,11 @@ void Penelope::doSomething()
                         
                         if(getWorld()->isFlameBlockedAt(newX, newY))        // stops flames when blocked
                             break;
-                        getWorld()->addActor(new Flame(getWorld(), newX, newY, getDirection()));
+                        flameX[count] = newX;
+                        flameY[count] = newY;
+                        count++;
                     }
+                    getWorld()->addFlames(flameX, flameY, count, getDirection());
                     getWorld()->playSound(SOUND_PLAYER_FIRE);
                     numFlames--;
                 }
@@ -438,6 +512,13 @@ void Penelope::doSomething()
     }
 }
 
+// infection ran its course
+void Penelope::timerExpired()
+{
+    setAlive(false);
+    getWorld()->playSound(SOUND_PLAYER_DIE);
+}
+
 void Penelope::useExitIfAppropriate()
 {
     if(getWorld()->getNumCitizens() == 0)
@@ -477,48 +558,36 @@ void Penelope::setExit(bool state) { exit = state; }
 
 // Citizen implementation
 
-Citizen::Citizen(StudentWorld* myWorld, double x, double y)
-: Person(myWorld, IID_CITIZEN, x, y), ticks(0)
+Citizen::Citizen(StudentWorld* myWorld, Coord x, Coord y)
+: Person(myWorld, IID_CITIZEN, x, y)
 {}
 
-void Citizen::doSomething()
+// infection ran its course; turn into a zombie
+void Citizen::timerExpired()
 {
-    if(!isAlive())
-        return;
+    setAlive(false);
+    getWorld()->playSound(SOUND_ZOMBIE_BORN);
+    getWorld()->increaseScore(-1000);
+    getWorld()->recordCitizenGone();
+    if(randInt(1, 10) <= 7)                 // 70% chance of turning into dumb zombie
+        getWorld()->addActor(new DumbZombie(getWorld(), getX(), getY()));
+    else
+        getWorld()->addActor(new SmartZombie(getWorld(), getX(), getY()));
+}
 
-    if(getInfectionCount() > 0)        // if citizen is infected
-    {
-        incrementInfectionCount();
-        
-        if(getInfectionCount() >= 500)
-        {
-            setAlive(false);
-            getWorld()->playSound(SOUND_ZOMBIE_BORN);
-            getWorld()->increaseScore(-1000);
-            getWorld()->recordCitizenGone();
-            if(randInt(1, 10) <= 7)                 // 70% chance of turning into dumb zombie
-                getWorld()->addActor(new DumbZombie(getWorld(), getX(), getY()));
-            else
-                getWorld()->addActor(new SmartZombie(getWorld(), getX(), getY()));
-            return;
-        }
-    }
-    
-    // paralyzed every other tick
-    if(ticks % 2 == 0)
-    {
-        ticks++;
+// plans a step toward Penelope or away from zombies; the step is taken
+// at commit if nobody has moved into the way
+void Citizen::decide()
+{
+    if(!isAlive())
         return;
-    }
     
-    ticks--;
-    
-    double distance = MAX_INT;
-    double otherX;
-    double otherY;
+    int distance = MAX_INT;
+    Coord otherX;
+    Coord otherY;
     bool isThreat;
     
-    int dest_x, dest_y;
+    int dest_x = getX(), dest_y = getY();
     
     // locate closest trigger
     getWorld()->locateNearestCitizenTrigger(getX(), getY(), otherX, otherY, distance, isThreat);
@@ -532,16 +601,14 @@ void Citizen::doSomething()
             dest_y = getY();
             if(getX() < otherX && !getWorld()->isAgentMovementBlockedAt(dest_x, dest_y, this))
             {
-                setDirection(right);
-                moveTo(dest_x, dest_y);
+                planMove(right, dest_x, dest_y);
                 return;
             }
             dest_x = getX() - 2;
             dest_y = getY();
             if(getX() > otherX && !getWorld()->isAgentMovementBlockedAt(dest_x, dest_y, this))
             {
-                setDirection(left);
-                moveTo(dest_x, dest_y);
+                planMove(left, dest_x, dest_y);
                 return;
             }
         }
@@ -551,16 +618,14 @@ void Citizen::doSomething()
             dest_y = getY() + 2;
             if(getY() < otherY && !getWorld()->isAgentMovementBlockedAt(dest_x, dest_y, this))
             {
-                setDirection(up);
-                moveTo(dest_x, dest_y);
+                planMove(up, dest_x, dest_y);
                 return;
             }
             dest_x = getX();
             dest_y = getY() - 2;
             if(getY() > otherY && !getWorld()->isAgentMovementBlockedAt(dest_x, dest_y, this))
             {
-                setDirection(down);
-                moveTo(dest_x, dest_y);
+                planMove(down, dest_x, dest_y);
                 return;
             }
         }
@@ -572,16 +637,14 @@ void Citizen::doSomething()
                 dest_y = getY();
                 if(getX() < otherX && !getWorld()->isAgentMovementBlockedAt(dest_x, dest_y, this))
                 {
-                    setDirection(right);
-                    moveTo(dest_x, dest_y);
+                    planMove(right, dest_x, dest_y);
                     return;
                 }
                 dest_x = getX() - 2;
                 dest_y = getY();
                 if(getX() > otherX && !getWorld()->isAgentMovementBlockedAt(dest_x, dest_y, this))
                 {
-                    setDirection(left);
-                    moveTo(dest_x, dest_y);
+                    planMove(left, dest_x, dest_y);
                     return;
                 }
             }
@@ -591,23 +654,21 @@ void Citizen::doSomething()
                 dest_y = getY() + 2;
                 if(getY() < otherY && !getWorld()->isAgentMovementBlockedAt(dest_x, dest_y, this))
                 {
-                    setDirection(up);
-                    moveTo(dest_x, dest_y);
+                    planMove(up, dest_x, dest_y);
                     return;
                 }
                 dest_x = getX();
                 dest_y = getY() - 2;
                 if(getY() > otherY && !getWorld()->isAgentMovementBlockedAt(dest_x, dest_y, this))
                 {
-                    setDirection(down);
-                    moveTo(dest_x, dest_y);
+                    planMove(down, dest_x, dest_y);
                     return;
                 }
             }
         }
     }
     
-    double zombieDistance = MAX_INT;
+    int zombieDistance = MAX_INT;
 
     // get nearest zombie info
     getWorld()->locateNearestCitizenThreat(getX(), getY(), otherX, otherY, zombieDistance);
@@ -615,10 +676,10 @@ void Citizen::doSomething()
     if(isThreat && zombieDistance <= 6400)
     {
         // move away from zombies
-        double distanceUp = MAX_INT;
-        double distanceDown = MAX_INT;
-        double distanceLeft = MAX_INT;
-        double distanceRight = MAX_INT;
+        int distanceUp = MAX_INT;
+        int distanceDown = MAX_INT;
+        int distanceLeft = MAX_INT;
+        int distanceRight = MAX_INT;
         
         int distanceTracker = zombieDistance;
         int longest = -1;
@@ -654,33 +715,26 @@ void Citizen::doSomething()
         if(longest == -1)
             return;
         
-        // set direction and move farthest away from nearest zombie
+        // plan to move farthest away from nearest zombie
         switch (longest) {
             case up:
-                setDirection(up);
                 dest_x = getX();
                 dest_y = getY() + 2;
-                moveTo(dest_x, dest_y);
                 break;
             case down:
-                setDirection(down);
                 dest_x = getX();
                 dest_y = getY() - 2;
-                moveTo(dest_x, dest_y);
                 break;
             case left:
-                setDirection(left);
                 dest_x = getX() - 2;
                 dest_y = getY();
-                moveTo(dest_x, dest_y);
                 break;
             case right:
-                setDirection(right);
                 dest_x = getX() + 2;
                 dest_y = getY();
-                moveTo(dest_x, dest_y);
                 break;
         }
+        planMove(longest, dest_x, dest_y);
     }
 }
 
@@ -709,116 +763,134 @@ void Citizen::beVomitedOnIfAppropriate()
     Person::beVomitedOnIfAppropriate();
 }
 
+// citizens are paralyzed every other tick
+int Citizen::getTickPeriod() const { return 2; }
+
 // Zombie implementation
 
-Zombie::Zombie(StudentWorld* myWorld, double x, double y)
-: Agent(myWorld, IID_ZOMBIE, x, y, right)
+Zombie::Zombie(StudentWorld* myWorld, Coord x, Coord y)
+: Agent(myWorld, IID_ZOMBIE, x, y, right), movementPlan(0), hasPlannedVomit(false),
+  vomitX(0), vomitY(0)
 {}
 
 bool Zombie::threatensCitizens() const { return true; }
 
-void Zombie::vomitIfPossible()
+// zombies are paralyzed every other tick
+int Zombie::getTickPeriod() const { return 2; }
+
+// vomits on a person in front and takes one step of its movement plan,
+// picking a new plan when the old one is used up
+void Zombie::decide()
 {
-    // if person in front of direction its facing
-    double vomitX = getX();     // change according to direction
-    double vomitY = getY();     // change according to direction
+    if(!isAlive())
+        return;
     
-    switch (getDirection()) {
+    planVomitIfPossible();
+    
+    plannedDir = getDirection();
+    if(movementPlan == 0)
+    {
+        movementPlan = randInt(3, 10);
+        chooseDirection();
+    }
+    
+    int destX = getX();
+    int destY = getY();
+    
+    switch(plannedDir) {
         case up:
-            vomitY += SPRITE_HEIGHT;
+            destY += 1;
             break;
         case down:
-            vomitY -= SPRITE_HEIGHT;
+            destY -= 1;
             break;
         case left:
-            vomitX -= SPRITE_WIDTH;
+            destX -= 1;
             break;
         case right:
-            vomitX += SPRITE_WIDTH;
+            destX += 1;
             break;
     }
     
-    if(getWorld()->isZombieVomitTriggerAt(vomitX, vomitY))
+    planMove(plannedDir, destX, destY);
+}
+
+void Zombie::commit()
+{
+    if(hasPlannedVomit)
     {
-        if(randInt(1, 3) == 3)          // 1 in 3 chance of vomiting
-        {
-            getWorld()->addActor(new Vomit(getWorld(), vomitX, vomitY, getDirection()));
-            getWorld()->playSound(SOUND_ZOMBIE_VOMIT);
-            return;
-        }
+        hasPlannedVomit = false;
+        getWorld()->addVomit(vomitX, vomitY, getDirection());
+        getWorld()->playSound(SOUND_ZOMBIE_VOMIT);
     }
+    
+    if(!hasPlannedMove)
+        return;
+    
+    // zombies turn even when the step is blocked, which ends the plan
+    hasPlannedMove = false;
+    setDirection(plannedDir);
+    
+    if(!getWorld()->isAgentMovementBlockedAt(plannedX, plannedY, this))
+    {
+        moveTo(plannedX, plannedY);
+        movementPlan--;
+    }
+    else
+        movementPlan = 0;
 }
 
-// move like zombies do
-void Zombie::zombieMove(int& movementPlan)
+void Zombie::planVomitIfPossible()
 {
-    int destX = getX();
-    int destY = getY();
+    // if person in front of direction its facing
+    int x = getX();     // change according to direction
+    int y = getY();     // change according to direction
     
-    switch(getDirection()) {
+    switch (getDirection()) {
         case up:
-            destY += 1;
+            y += SPRITE_HEIGHT;
             break;
         case down:
-            destY -= 1;
+            y -= SPRITE_HEIGHT;
             break;
         case left:
-            destX -= 1;
+            x -= SPRITE_WIDTH;
             break;
         case right:
-            destX += 1;
+            x += SPRITE_WIDTH;
             break;
     }
     
-    if(!getWorld()->isAgentMovementBlockedAt(destX, destY, this))
+    if(getWorld()->isZombieVomitTriggerAt(x, y))
     {
-        moveTo(destX, destY);
-        movementPlan--;
+        if(randInt(1, 3) == 3)          // 1 in 3 chance of vomiting
+        {
+            hasPlannedVomit = true;
+            vomitX = x;
+            vomitY = y;
+        }
     }
-    else
-        movementPlan = 0;
 }
 
 // DumbZombie implementation
 
-DumbZombie::DumbZombie(StudentWorld* myWorld, double x, double y)
-: Zombie(myWorld, x, y), ticks(0), movementPlan(0)
+DumbZombie::DumbZombie(StudentWorld* myWorld, Coord x, Coord y)
+: Zombie(myWorld, x, y)
 {}
 
-void DumbZombie::doSomething()
+// randomized movement
+void DumbZombie::chooseDirection()
 {
-    if(!isAlive())
-        return;
-    
-    // paralyzed every other tick
-    if(ticks % 2 == 0)
-    {
-        ticks++;
-        return;
-    }
-    
-    ticks--;
-    
-    // vomits on nearby
-    vomitIfPossible();
+    int direct = randInt(1, 4);
     
-    if(movementPlan == 0)
-    {
-        // randomized movement
-        movementPlan = randInt(3, 10);
-        int direct = randInt(1, 4);
-        
-        if(direct == 1)
-            setDirection(up);
-        else if(direct == 2)
-            setDirection(down);
-        else if(direct == 3)
-            setDirection(left);
-        else if(direct == 4)
-            setDirection(right);
-    }
-    
-    zombieMove(movementPlan);
+    if(direct == 1)
+        plannedDir = up;
+    else if(direct == 2)
+        plannedDir = down;
+    else if(direct == 3)
+        plannedDir = left;
+    else if(direct == 4)
+        plannedDir = right;
 }
 
 void DumbZombie::dieByFallOrBurnIfAppropriate()
@@ -857,84 +929,65 @@ void DumbZombie::dieByFallOrBurnIfAppropriate()
 
 // SmartZombie implementation
 
-SmartZombie::SmartZombie(StudentWorld* myWorld, double x, double y)
-: Zombie(myWorld, x, y), ticks(0), movementPlan(0)
+SmartZombie::SmartZombie(StudentWorld* myWorld, Coord x, Coord y)
+: Zombie(myWorld, x, y)
 {}
 
-void SmartZombie::doSomething()
+// heads toward the nearest visible person, otherwise moves randomly
+void SmartZombie::chooseDirection()
 {
-    if(!isAlive())
-        return;
+    Coord otherX, otherY;
+    int distance;
     
-    // paralyzed every other tick
-    if(ticks % 2 == 0)
-    {
-        ticks++;
-        return;
-    }
-    
-    ticks--;
-    
-    vomitIfPossible();
-    
-    double otherX, otherY, distance;
-    
-    if(movementPlan == 0)
+    if(getWorld()->locateNearestVomitTrigger(getX(), getY(), otherX, otherY, distance))
     {
-        movementPlan = randInt(3, 10);
-        
-        if(getWorld()->locateNearestVomitTrigger(getX(), getY(), otherX, otherY, distance))
+        // move toward trigger
+        if(getY() == otherY)
+        {
+            if(getX() < otherX)
+                plannedDir = right;
+            if(getX() > otherX)
+                plannedDir = left;
+        }
+        else if(getX() == otherX)
+        {
+            if(getY() < otherY)
+                plannedDir = up;
+            if(getY() > otherY)
+                plannedDir = down;
+        }
+        else
         {
-            // move toward trigger
-            if(getY() == otherY)
+            if(randInt(0, 1) == 0)  // horizontal
             {
                 if(getX() < otherX)
-                    setDirection(right);
+                    plannedDir = right;
                 if(getX() > otherX)
-                    setDirection(left);
+                    plannedDir = left;
             }
-            else if(getX() == otherX)
+            else                    // vertical
             {
                 if(getY() < otherY)
-                    setDirection(up);
+                    plannedDir = up;
                 if(getY() > otherY)
-                    setDirection(down);
-            }
-            else
-            {
-                if(randInt(0, 1) == 0)  // horizontal
-                {
-                    if(getX() < otherX)
-                        setDirection(right);
-                    if(getX() > otherX)
-                        setDirection(left);
-                }
-                else                    // vertical
-                {
-                    if(getY() < otherY)
-                        setDirection(up);
-                    if(getY() > otherY)
-                        setDirection(down);
-                }
+                    plannedDir = down;
             }
         }
-        else
-        {
-            // move randomly
-            int direct = randInt(1, 4);
-            
-            if(direct == 1)
-                setDirection(up);
-            else if(direct == 2)
-                setDirection(down);
-            else if(direct == 3)
-                setDirection(left);
-            else if(direct == 4)
-                setDirection(right);
-        }
     }
-    
-    zombieMove(movementPlan);
+    else
+    {
+        // move randomly
+        int direct = randInt(1, 4);
+        
+        if(direct == 1)
+            plannedDir = up;
+        else if(direct == 2)
+            plannedDir = down;
+        else if(direct == 3)
+            plannedDir = left;
+        else if(direct == 4)
+            plannedDir = right;
+    }
 }
 
 void SmartZombie::dieByFallOrBurnIfAppropriate()
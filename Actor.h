@@ -2,6 +2,7 @@
 #define ACTOR_H_
 
 #include "GraphObject.h"
+#include "TimerWheel.h"
 
 const int MAX_INT = 2147483647;             // max integer constant
 
@@ -12,11 +13,22 @@ class Goodie;
 class Actor : public GraphObject
 {
 public:
-    Actor(StudentWorld* myWorld, int imageID, double x, double y, Direction dir, int depth, double size);
+    Actor(StudentWorld* myWorld, int imageID, Coord x, Coord y, Direction dir, int depth, double size);
     
     // All Actors get to do something each tick
     virtual void doSomething() = 0;
     
+    // How often StudentWorld calls doSomething: every N ticks, or 0 for
+    // objects that only react to StudentWorld's timers and contact passes.
+    virtual int getTickPeriod() const;                      // default 1
+    
+    // StudentWorld splits each due actor's tick in two. decide() plans
+    // the action while other actors plan theirs on other threads, so it
+    // may read the world but change nothing outside this object. commit()
+    // then carries the plan out, one actor at a time.
+    virtual void decide();                                  // default return
+    virtual void commit();                                  // default doSomething()
+    
     // If object can block movement
     virtual bool canBlockMovement() const;                  // default false
     
@@ -48,23 +60,50 @@ public:
     // Is this object a threat to citizens?
     virtual bool threatensCitizens() const;                 // default false
     
+    // Does this object act on whatever overlaps it? StudentWorld then
+    // calls activateIfAppropriate for each overlapping agent once per tick,
+    // so the object needs no per-tick scan of its own.
+    virtual bool activatesOnContact() const;                // default false
+    
+    // Does this object set off the contact activators it overlaps?
+    virtual bool triggersContacts() const;                  // default false
+    
+    // Called by StudentWorld when a timer this object scheduled comes due
+    virtual void timerExpired();                            // default return
+    
     // Accesses Actor's alive state
     bool isAlive() const;
     
-    // Sets Actor alive state
+    // Sets Actor alive state; an actor that dies is handed to
+    // StudentWorld to be removed at the end of the tick
     void setAlive(bool state);
     
     // Accesses Actor's StudentWorld
     StudentWorld* getWorld() const;
+    
+    // Moves to (x,y) and lets StudentWorld update its packed copy of
+    // this actor's position
+    virtual void moveTo(Coord x, Coord y);
+    
+    // Position StudentWorld keeps this actor at in its actor list
+    int getSlot() const;
+    void setSlot(int s);
+    
+    // Position StudentWorld keeps this actor at among actors of its type
+    int getTypeSlot() const;
+    void setTypeSlot(int s);
 private:
     StudentWorld* world;
     bool alive;
+    int slot;
+    int typeSlot;
 };
 
 class Wall : public Actor
 {
 public:
-    Wall(StudentWorld* myWorld, double x, double y);
+    Wall(StudentWorld* myWorld, Coord x, Coord y);
+    virtual int getTickPeriod() const;
     virtual void doSomething();
     virtual bool canBlockMovement() const;
     virtual bool canBlockFlame() const;         
@@ -74,66 +113,80 @@ private:
 class ActivatingObject : public Actor
 {
 public:
-    ActivatingObject(StudentWorld* myWorld, int imageID, double x, double y, int depth, int dir);
+    ActivatingObject(StudentWorld* myWorld, int imageID, Coord x, Coord y, int depth, int dir);
     virtual void activateIfAppropriate(Actor* a) = 0;
 };
 
 class Exit : public ActivatingObject
 {
 public:
-    Exit(StudentWorld* myWorld, double x, double y);
+    Exit(StudentWorld* myWorld, Coord x, Coord y);
+    virtual int getTickPeriod() const;
     virtual void doSomething();
     virtual void activateIfAppropriate(Actor* a);
     virtual bool canBlockFlame() const;
+    virtual bool activatesOnContact() const;
 private:
 };
 
 class Pit : public ActivatingObject
 {
 public:
-    Pit(StudentWorld* myWorld, double x, double y);
+    Pit(StudentWorld* myWorld, Coord x, Coord y);
+    virtual int getTickPeriod() const;
     virtual void doSomething();
     virtual void activateIfAppropriate(Actor* a);
+    virtual bool activatesOnContact() const;
 };
 
 class Flame : public ActivatingObject
 {
 public:
-    Flame(StudentWorld* myWorld, double x, double y, int dir);
+    Flame(StudentWorld* myWorld, Coord x, Coord y, int dir);
+    virtual int getTickPeriod() const;
     virtual void doSomething();
     virtual void activateIfAppropriate(Actor* a);
+    virtual void timerExpired();
 private:
-    int ticks;
+    TimerWheel::Timer expireTimer;      // goes out when this fires
 };
 
 class Vomit : public ActivatingObject
 {
 public:
-    Vomit(StudentWorld* myWorld, double x, double y, int dir);
+    Vomit(StudentWorld* myWorld, Coord x, Coord y, int dir);
+    virtual int getTickPeriod() const;
     virtual void doSomething();
     virtual void activateIfAppropriate(Actor* a);
+    virtual void timerExpired();
 private:
-    int ticks;
+    TimerWheel::Timer expireTimer;      // disappears when this fires
 };
 
 class Landmine : public ActivatingObject
 {
 public:
-    Landmine(StudentWorld* myWorld, double x, double y);
+    Landmine(StudentWorld* myWorld, Coord x, Coord y);
+    virtual int getTickPeriod() const;
     virtual void doSomething();
     virtual void activateIfAppropriate(Actor* a);
     virtual void dieByFallOrBurnIfAppropriate();
+    virtual bool activatesOnContact() const;
+    virtual void timerExpired();
 private:
     void explode();         // landmine explosion handling
-    int safetyTicks;
+    bool armed;                         // set once the safety period ends
+    TimerWheel::Timer armTimer;         // fires when the safety period ends
 };
 
 class Goodie : public ActivatingObject
 {
 public:
-    Goodie(StudentWorld* myWorld, int imageID, double x, double y);
+    Goodie(StudentWorld* myWorld, int imageID, Coord x, Coord y);
+    virtual int getTickPeriod() const;
     virtual void activateIfAppropriate(Actor* a);
     virtual void dieByFallOrBurnIfAppropriate();
+    virtual bool activatesOnContact() const;
     
     // Have p pick up this goodie.
     virtual void pickUp(Penelope* p) = 0;
@@ -142,7 +195,7 @@ public:
 class VaccineGoodie : public Goodie
 {
 public:
-    VaccineGoodie(StudentWorld* myWorld, double x, double y);
+    VaccineGoodie(StudentWorld* myWorld, Coord x, Coord y);
     virtual void doSomething();
     virtual void pickUp(Penelope* p);
 };
@@ -150,7 +203,7 @@ public:
 class GasCanGoodie : public Goodie
 {
 public:
-    GasCanGoodie(StudentWorld* myWorld, double x, double y);
+    GasCanGoodie(StudentWorld* myWorld, Coord x, Coord y);
     virtual void doSomething();
     virtual void pickUp(Penelope* p);
 };
@@ -158,7 +211,7 @@ public:
 class LandmineGoodie : public Goodie
 {
 public:
-    LandmineGoodie(StudentWorld* myWorld, double x, double y);
+    LandmineGoodie(StudentWorld* myWorld, Coord x, Coord y);
     virtual void doSomething();
     virtual void pickUp(Penelope* p);
 };
@@ -166,31 +219,49 @@ public:
 class Agent : public Actor
 {
 public:
-    Agent(StudentWorld* myWorld, int imageID, double x, double y, int dir);
+    Agent(StudentWorld* myWorld, int imageID, Coord x, Coord y, int dir);
+    virtual void doSomething();                 // decide() then commit()
+    virtual void commit();                      // makes the planned move
     virtual bool canBlockMovement() const;
     virtual bool triggersOnlyActiveLandmines() const;
+    virtual bool triggersContacts() const;
+protected:
+    // Plans to face dir and step to (x,y) at commit, if still open then
+    void planMove(Direction dir, Coord x, Coord y);
+    
+    // Uniform random int from min to max, inclusive. Each agent draws from
+    // its own stream seeded by StudentWorld, so its choices do not depend
+    // on which thread decides for it or what other agents drew.
+    int randInt(int min, int max);
+    
+    bool hasPlannedMove;
+    Direction plannedDir;
+    Coord plannedX;
+    Coord plannedY;
+private:
+    unsigned long long randomState;
 };
 
 class Person : public Agent
 {
 public:
-    Person(StudentWorld* myWorld, int imageID, double x, double y);
+    Person(StudentWorld* myWorld, int imageID, Coord x, Coord y);
     virtual void beVomitedOnIfAppropriate();
     virtual bool triggersZombieVomit() const;
     
-    void clearInfection();              // resets infectionCount to 0
-    int getInfectionCount() const;      // returns infectionCount
-    int incrementInfectionCount();      // adds 1 to infectionCount
+    void clearInfection();              // cures any infection
+    int getInfectionCount() const;      // ticks infected plus extra vomits
 private:
-    int infectionCount;
+    TimerWheel::Timer infectionTimer;   // fires when infection count hits 500
     bool exit;
 };
 
 class Penelope : public Person
 {
 public:
-    Penelope(StudentWorld* myWorld, double x, double y);
+    Penelope(StudentWorld* myWorld, Coord x, Coord y);
     virtual void doSomething();
+    virtual void timerExpired();
     virtual void useExitIfAppropriate();
     virtual void dieByFallOrBurnIfAppropriate();
     virtual void pickUpGoodieIfAppropriate(Goodie* g);
@@ -214,44 +285,51 @@ private:
 class Citizen : public Person
 {
 public:
-    Citizen(StudentWorld* myWorld, double x, double y);
-    virtual void doSomething();
+    Citizen(StudentWorld* myWorld, Coord x, Coord y);
+    virtual void decide();
+    virtual void timerExpired();
     virtual void useExitIfAppropriate();
     virtual void dieByFallOrBurnIfAppropriate();
     virtual void beVomitedOnIfAppropriate();
-private:
-    int ticks;
+    virtual int getTickPeriod() const;
 };
 
 class Zombie : public Agent
 {
 public:
-    Zombie(StudentWorld* myWorld, double x, double y);
+    Zombie(StudentWorld* myWorld, Coord x, Coord y);
     virtual bool threatensCitizens() const;
-    void vomitIfPossible();                     // vomits on nearby actor if possible
-    void zombieMove(int& movementPlan);         // handles zombie movement
+    virtual int getTickPeriod() const;
+    virtual void decide();
+    virtual void commit();
+protected:
+    // Picks a direction for a new movement plan
+    virtual void chooseDirection() = 0;
+private:
+    void planVomitIfPossible();                 // plans vomit on a person in front
+    
+    int movementPlan;                           // steps left in current direction
+    bool hasPlannedVomit;
+    Coord vomitX;
+    Coord vomitY;
 };
 
 class DumbZombie : public Zombie
 {
 public:
-    DumbZombie(StudentWorld* myWorld, double x, double y);
-    virtual void doSomething();
+    DumbZombie(StudentWorld* myWorld, Coord x, Coord y);
     virtual void dieByFallOrBurnIfAppropriate();
-private:
-    int ticks;
-    int movementPlan;
+protected:
+    virtual void chooseDirection();
 };
 
 class SmartZombie : public Zombie
 {
 public:
-    SmartZombie(StudentWorld* myWorld, double x, double y);
-    virtual void doSomething();
+    SmartZombie(StudentWorld* myWorld, Coord x, Coord y);
     virtual void dieByFallOrBurnIfAppropriate();
-private:
-    int ticks;
-    int movementPlan;
+protected:
+    virtual void chooseDirection();
 };
 
 #endif // ACTOR_H_
@@ -0,0 +1,94 @@
+#ifndef ACTORGRID_H_
+#define ACTORGRID_H_
+
+#include "Actor.h"
+#include "GameConstants.h"
+#include <vector>
+#include <algorithm>
+
+// Buckets actors by the sprite-sized cell their (x,y) corner falls in.
+// Two actors overlap when their corners are within 10 pixels of each other,
+// so an overlap query only has to look at the 3x3 block of cells around it.
+class ActorGrid
+{
+public:
+    ActorGrid()
+    : width(0), height(0)
+    {}
+
+    // Sizes the grid to width x height cells and empties it
+    void reset(int w, int h)
+    {
+        width = w;
+        height = h;
+        cells.assign(width * height, std::vector<Actor*>());
+    }
+
+    // Empties every cell but keeps their storage for reuse
+    void clear()
+    {
+        for(size_t i = 0; i < cells.size(); i++)
+            cells[i].clear();
+    }
+
+    void insert(Actor* a)
+    {
+        cells[cellOf(a->getX(), a->getY())].push_back(a);
+    }
+
+    // Drops every actor gone(a) is true for from the cell holding (x,y),
+    // keeping the rest in order; actors must not have moved since they
+    // were inserted
+    template<typename Pred>
+    void removeIf(int x, int y, Pred gone)
+    {
+        std::vector<Actor*>& cell = cells[cellOf(x, y)];
+        cell.erase(std::remove_if(cell.begin(), cell.end(), gone), cell.end());
+    }
+
+    // Calls f on every actor bucketed within one cell of (x,y)
+    template<typename Func>
+    void forEachNear(int x, int y, Func f) const
+    {
+        forEachInCells(x / SPRITE_WIDTH - 1, y / SPRITE_HEIGHT - 1,
+                       x / SPRITE_WIDTH + 1, y / SPRITE_HEIGHT + 1, f);
+    }
+
+    // Calls f on every actor bucketed in a cell that overlaps the pixel
+    // rectangle from (minX,minY) to (maxX,maxY)
+    template<typename Func>
+    void forEachInRect(int minX, int minY, int maxX, int maxY, Func f) const
+    {
+        forEachInCells(minX / SPRITE_WIDTH, minY / SPRITE_HEIGHT,
+                       maxX / SPRITE_WIDTH, maxY / SPRITE_HEIGHT, f);
+    }
+
+private:
+    template<typename Func>
+    void forEachInCells(int minCellX, int minCellY, int maxCellX, int maxCellY, Func f) const
+    {
+        for(int cy = clampY(minCellY); cy <= clampY(maxCellY); cy++)
+        {
+            for(int cx = clampX(minCellX); cx <= clampX(maxCellX); cx++)
+            {
+                const std::vector<Actor*>& cell = cells[cy*width + cx];
+                for(size_t i = 0; i < cell.size(); i++)
+                    f(cell[i]);
+            }
+        }
+    }
+
+    int clampX(int cx) const { return std::max(0, std::min(width-1, cx)); }
+    int clampY(int cy) const { return std::max(0, std::min(height-1, cy)); }
+
+    int cellOf(int x, int y) const
+    {
+        return clampY(y / SPRITE_HEIGHT) * width + clampX(x / SPRITE_WIDTH);
+    }
+
+    int width;
+    int height;
+    std::vector<std::vector<Actor*>> cells;
+};
+
+#endif // ACTORGRID_H_
@@ -0,0 +1,206 @@
+#ifndef ACTORTYPES_H_
+#define ACTORTYPES_H_
+
+#include "Actor.h"
+#include <vector>
+#include <tuple>
+#include <typeinfo>
+#include <cassert>
+
+// What each concrete actor type can do, known at compile time. These
+// mirror the virtual capability queries on Actor (canBlockMovement,
+// canBlockFlame, ...); TypedActorLists checks the two agree whenever it
+// files an actor.
+template<typename T>
+struct ActorTraits
+{
+    static constexpr bool blocksMovement = false;
+    static constexpr bool blocksFlame = false;
+    static constexpr bool triggersZombieVomit = false;
+    static constexpr bool threatensCitizens = false;
+};
+
+template<>
+struct ActorTraits<Wall>
+{
+    static constexpr bool blocksMovement = true;
+    static constexpr bool blocksFlame = true;
+    static constexpr bool triggersZombieVomit = false;
+    static constexpr bool threatensCitizens = false;
+};
+
+template<>
+struct ActorTraits<Exit>
+{
+    static constexpr bool blocksMovement = false;
+    static constexpr bool blocksFlame = true;
+    static constexpr bool triggersZombieVomit = false;
+    static constexpr bool threatensCitizens = false;
+};
+
+template<>
+struct ActorTraits<Citizen>
+{
+    static constexpr bool blocksMovement = true;
+    static constexpr bool blocksFlame = false;
+    static constexpr bool triggersZombieVomit = true;
+    static constexpr bool threatensCitizens = false;
+};
+
+template<>
+struct ActorTraits<DumbZombie>
+{
+    static constexpr bool blocksMovement = true;
+    static constexpr bool blocksFlame = false;
+    static constexpr bool triggersZombieVomit = false;
+    static constexpr bool threatensCitizens = true;
+};
+
+template<>
+struct ActorTraits<SmartZombie> : ActorTraits<DumbZombie>
+{};
+
+// Capabilities to select types by in TypedActorLists::anyOf
+struct BlocksMovement
+{
+    template<typename T> static constexpr bool of() { return ActorTraits<T>::blocksMovement; }
+};
+
+struct BlocksFlame
+{
+    template<typename T> static constexpr bool of() { return ActorTraits<T>::blocksFlame; }
+};
+
+struct TriggersZombieVomit
+{
+    template<typename T> static constexpr bool of() { return ActorTraits<T>::triggersZombieVomit; }
+};
+
+struct ThreatensCitizens
+{
+    template<typename T> static constexpr bool of() { return ActorTraits<T>::threatensCitizens; }
+};
+
+// One list per concrete type, holding pointers of that exact type, so a
+// loop over one list calls the type's own functions directly and a query
+// that only cares about some capability skips the other types' lists
+// without looking at them. Penelope lives apart, as everywhere else.
+template<typename... Ts>
+class TypedActorLists
+{
+public:
+    void clear()
+    {
+        int expand[] = { 0, (std::get<std::vector<Ts*>>(lists).clear(), 0)... };
+        (void)expand;
+    }
+
+    // Files a under its concrete type and records where
+    void insert(Actor* a)
+    {
+        bool filed = false;
+        int expand[] = { 0, (filed = filed || insertAs<Ts>(a), 0)... };
+        (void)expand;
+    }
+
+    // Takes a out by moving the last actor of its type into its place
+    void remove(Actor* a)
+    {
+        bool found = false;
+        int expand[] = { 0, (found = found || removeAs<Ts>(a), 0)... };
+        (void)expand;
+    }
+
+    // Files a under its concrete type without recording where, for
+    // lists rebuilt every time they are used
+    void push(Actor* a)
+    {
+        bool filed = false;
+        int expand[] = { 0, (filed = filed || pushAs<Ts>(a), 0)... };
+        (void)expand;
+    }
+
+    template<typename T>
+    const std::vector<T*>& get() const
+    {
+        return std::get<std::vector<T*>>(lists);
+    }
+
+    // Calls f on each type's list in turn
+    template<typename F>
+    void forEachList(F f)
+    {
+        int expand[] = { 0, (f(std::get<std::vector<Ts*>>(lists)), 0)... };
+        (void)expand;
+    }
+
+    // Calls f on each actor of every type with capability Cap, stopping
+    // and returning true as soon as f does
+    template<typename Cap, typename F>
+    bool anyOf(F f) const
+    {
+        bool found = false;
+        int expand[] = { 0, (found = found || anyOfType<Ts, Cap>(f), 0)... };
+        (void)expand;
+        return found;
+    }
+
+private:
+    template<typename T>
+    bool pushAs(Actor* a)
+    {
+        if(typeid(*a) != typeid(T))
+            return false;
+        std::get<std::vector<T*>>(lists).push_back(static_cast<T*>(a));
+        return true;
+    }
+
+    template<typename T>
+    bool insertAs(Actor* a)
+    {
+        if(!pushAs<T>(a))
+            return false;
+        assert(a->canBlockMovement() == ActorTraits<T>::blocksMovement);
+        assert(a->canBlockFlame() == ActorTraits<T>::blocksFlame);
+        assert(a->triggersZombieVomit() == ActorTraits<T>::triggersZombieVomit);
+        assert(a->threatensCitizens() == ActorTraits<T>::threatensCitizens);
+        a->setTypeSlot(static_cast<int>(get<T>().size()) - 1);
+        return true;
+    }
+
+    template<typename T>
+    bool removeAs(Actor* a)
+    {
+        if(typeid(*a) != typeid(T))
+            return false;
+        std::vector<T*>& list = std::get<std::vector<T*>>(lists);
+        int slot = a->getTypeSlot();
+        list[slot] = list.back();
+        list[slot]->setTypeSlot(slot);
+        list.pop_back();
+        return true;
+    }
+
+    template<typename T, typename Cap, typename F>
+    bool anyOfType(F& f) const
+    {
+        if(!Cap::template of<T>())
+            return false;
+        const std::vector<T*>& list = get<T>();
+        for(size_t i = 0; i < list.size(); i++)
+        {
+            if(f(list[i]))
+                return true;
+        }
+        return false;
+    }
+
+    std::tuple<std::vector<Ts*>...> lists;
+};
+
+// Every concrete actor type StudentWorld can hold
+typedef TypedActorLists<Wall, Exit, Pit, Flame, Vomit, Landmine,
+                        VaccineGoodie, GasCanGoodie, LandmineGoodie,
+                        Citizen, DumbZombie, SmartZombie> ActorLists;
+
+#endif // ACTORTYPES_H_
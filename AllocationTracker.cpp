@@ -0,0 +1,377 @@
+#include "AllocationTracker.h"
+#include <iostream>
+
+#ifdef TRACK_ALLOCATIONS
+
+#include <atomic>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+#if defined(__GLIBC__) || defined(__APPLE__)
+#define TRACK_CALL_SITES
+#include <execinfo.h>
+#include <dlfcn.h>
+#include <cxxabi.h>
+#endif
+
+#if defined(__GNUC__)
+#define TRACKER_NOINLINE __attribute__((noinline))
+#define TRACKER_INLINE inline __attribute__((always_inline))
+#else
+#define TRACKER_NOINLINE
+#define TRACKER_INLINE inline
+#endif
+
+using namespace std;
+
+namespace
+{
+    const int MAX_PHASES = 16;
+    const int SITE_FRAMES = 4;          // frames kept per call site
+    const int SKIPPED_FRAMES = 2;       // recordAllocation and operator new
+    const int SITE_BITS = 12;
+    const int MAX_SITES = 1 << SITE_BITS;
+
+    struct Counter
+    {
+        atomic<long long> count;
+        atomic<long long> bytes;
+    };
+
+    // a call stack and what was allocated from it; key is 0 while free,
+    // and has bit 1 set while its frames are being written
+    struct Site
+    {
+        atomic<unsigned long long> key;
+        void* frames[SITE_FRAMES];
+        atomic<long long> count;
+        atomic<long long> bytes;
+    };
+
+    // phase 0 is everything outside a tick
+    const char* phaseNames[MAX_PHASES] = { "between ticks" };
+    int numPhases = 1;
+    atomic<int> currentPhase(0);
+
+    Counter totals[MAX_PHASES];
+    Counter thisTick[MAX_PHASES];
+    Site sites[MAX_SITES];
+    atomic<long long> lostSites(0);     // allocations from sites past MAX_SITES
+
+    long long tickBudget = -1;
+    long long ticks = 0;
+    long long ticksOverBudget = 0;
+    long long busiestTick = -1;         // ticks count from 1
+    long long busiestTickCount = 0;
+    long long lastTickCount[MAX_PHASES];
+    long long lastTickBytes[MAX_PHASES];
+
+    // set while the tracker itself is running on this thread, so that
+    // what it allocates is not counted
+    thread_local bool inTracker = false;
+
+    void add(Counter& c, size_t bytes)
+    {
+        c.count.fetch_add(1, memory_order_relaxed);
+        c.bytes.fetch_add(static_cast<long long>(bytes), memory_order_relaxed);
+    }
+
+#ifdef TRACK_CALL_SITES
+    // finds or claims the site for the given frames by open addressing
+    Site* siteFor(void* const frames[SITE_FRAMES])
+    {
+        unsigned long long key = 0;
+        for(int i = 0; i < SITE_FRAMES; i++)
+            key = (key ^ reinterpret_cast<unsigned long long>(frames[i])) * 0x9E3779B97F4A7C15ULL;
+        key = (key & ~3ULL) | 1;
+
+        for(int probe = 0; probe < MAX_SITES; probe++)
+        {
+            Site& s = sites[((key >> (64 - SITE_BITS)) + probe) & (MAX_SITES - 1)];
+            unsigned long long seen = s.key.load(memory_order_acquire);
+            if(seen == 0)
+            {
+                // the frames are written before the key is published
+                unsigned long long claimed = 0;
+                if(s.key.compare_exchange_strong(claimed, key | 2, memory_order_acq_rel))
+                {
+                    memcpy(s.frames, frames, sizeof(s.frames));
+                    s.key.store(key, memory_order_release);
+                    return &s;
+                }
+                seen = claimed;
+            }
+            // another thread is still writing this site's frames
+            while(seen == (key | 2))
+                seen = s.key.load(memory_order_acquire);
+            if(seen == key)
+                return &s;
+        }
+        return nullptr;
+    }
+#endif
+
+    TRACKER_NOINLINE void recordAllocation(size_t bytes)
+    {
+        if(inTracker)
+            return;
+        inTracker = true;
+
+        int phase = currentPhase.load(memory_order_relaxed);
+        add(totals[phase], bytes);
+        add(thisTick[phase], bytes);
+
+#ifdef TRACK_CALL_SITES
+        void* stack[SKIPPED_FRAMES + SITE_FRAMES] = {};
+        backtrace(stack, SKIPPED_FRAMES + SITE_FRAMES);
+        Site* s = siteFor(stack + SKIPPED_FRAMES);
+        if(s != nullptr)
+        {
+            s->count.fetch_add(1, memory_order_relaxed);
+            s->bytes.fetch_add(static_cast<long long>(bytes), memory_order_relaxed);
+        }
+        else
+            lostSites.fetch_add(1, memory_order_relaxed);
+#endif
+
+        inTracker = false;
+    }
+
+    // inlined into each operator new, so that a call site is always two
+    // frames above recordAllocation
+    TRACKER_INLINE void* allocate(size_t bytes)
+    {
+        recordAllocation(bytes);
+        void* p = malloc(bytes == 0 ? 1 : bytes);
+        if(p == nullptr)
+            throw bad_alloc();
+        return p;
+    }
+
+    TRACKER_INLINE void* allocateAligned(size_t bytes, align_val_t alignment)
+    {
+        recordAllocation(bytes);
+        size_t a = static_cast<size_t>(alignment);
+        void* p = aligned_alloc(a, (bytes + a - 1) / a * a + (bytes == 0 ? a : 0));
+        if(p == nullptr)
+            throw bad_alloc();
+        return p;
+    }
+
+#ifdef TRACK_CALL_SITES
+    // names the function holding address, or gives its module and offset
+    string nameOf(void* address)
+    {
+        Dl_info info;
+        if(dladdr(address, &info) == 0)
+            return "?";
+        if(info.dli_sname != nullptr)
+        {
+            int status = 0;
+            char* demangled = abi::__cxa_demangle(info.dli_sname, nullptr, nullptr, &status);
+            string name = (status == 0 ? demangled : info.dli_sname);
+            free(demangled);
+            if(name.size() > 60)
+                name = name.substr(0, 57) + "...";
+            return name;
+        }
+        string module = (info.dli_fname != nullptr ? info.dli_fname : "?");
+        module = module.substr(module.find_last_of('/') + 1);
+        ostringstream oss;
+        oss << module << "+0x" << hex
+            << (reinterpret_cast<char*>(address) - reinterpret_cast<char*>(info.dli_fbase));
+        return oss.str();
+    }
+#endif
+}
+
+bool AllocationTracker::enabled() { return true; }
+
+void AllocationTracker::enterPhase(const char* name)
+{
+    int phase = 0;
+    while(phase < numPhases && phaseNames[phase] != name && strcmp(phaseNames[phase], name) != 0)
+        phase++;
+    if(phase == numPhases)
+    {
+        if(numPhases == MAX_PHASES)
+            phase = 0;
+        else
+            phaseNames[numPhases++] = name;
+    }
+    currentPhase.store(phase, memory_order_relaxed);
+}
+
+void AllocationTracker::beginTick()
+{
+    for(int i = 0; i < numPhases; i++)
+    {
+        thisTick[i].count.store(0, memory_order_relaxed);
+        thisTick[i].bytes.store(0, memory_order_relaxed);
+    }
+}
+
+bool AllocationTracker::endTick()
+{
+    currentPhase.store(0, memory_order_relaxed);
+
+    long long count = 0;
+    for(int i = 0; i < numPhases; i++)
+    {
+        lastTickCount[i] = thisTick[i].count.load(memory_order_relaxed);
+        lastTickBytes[i] = thisTick[i].bytes.load(memory_order_relaxed);
+        count += lastTickCount[i];
+    }
+
+    ticks++;
+    if(busiestTick < 0 || count > busiestTickCount)
+    {
+        busiestTick = ticks;
+        busiestTickCount = count;
+    }
+
+    bool withinBudget = (tickBudget < 0 || count <= tickBudget);
+    if(!withinBudget)
+        ticksOverBudget++;
+    return withinBudget;
+}
+
+void AllocationTracker::setTickBudget(long long allocations)
+{
+    tickBudget = allocations;
+}
+
+void AllocationTracker::report(ostream& out)
+{
+    inTracker = true;
+
+    long long count = 0, bytes = 0;
+    for(int i = 0; i < numPhases; i++)
+    {
+        count += totals[i].count.load(memory_order_relaxed);
+        bytes += totals[i].bytes.load(memory_order_relaxed);
+    }
+    double perTick = (ticks > 0 ? 1.0 / ticks : 0.0);
+
+    out << "Allocations: " << count << " (" << bytes << " bytes) over " << ticks << " ticks" << endl;
+    if(ticks > 0)
+    {
+        out << "Busiest tick: " << busiestTick << " with " << busiestTickCount << " allocations" << endl;
+        if(tickBudget >= 0)
+            out << "Ticks over the budget of " << tickBudget << ": " << ticksOverBudget << endl;
+    }
+
+    out << setw(24) << left << "phase" << right << setw(12) << "count" << setw(14) << "bytes"
+        << setw(12) << "per tick" << endl;
+    for(int i = 0; i < numPhases; i++)
+    {
+        long long c = totals[i].count.load(memory_order_relaxed);
+        out << "  " << setw(22) << left << phaseNames[i] << right << setw(12) << c
+            << setw(14) << totals[i].bytes.load(memory_order_relaxed)
+            << setw(12);
+        if(i == 0)
+            out << "" << endl;
+        else
+            out << fixed << setprecision(2) << c * perTick << endl;
+    }
+
+#ifdef TRACK_CALL_SITES
+    vector<const Site*> used;
+    for(int i = 0; i < MAX_SITES; i++)
+    {
+        if(sites[i].key.load(memory_order_acquire) != 0)
+            used.push_back(&sites[i]);
+    }
+    sort(used.begin(), used.end(), [](const Site* a, const Site* b)
+    {
+        return a->count.load(memory_order_relaxed) > b->count.load(memory_order_relaxed);
+    });
+    if(used.size() > 10)
+        used.resize(10);
+
+    out << "Busiest call sites (innermost frame first):" << endl;
+    for(const Site* s : used)
+    {
+        out << setw(12) << s->count.load(memory_order_relaxed)
+            << setw(14) << s->bytes.load(memory_order_relaxed) << "  ";
+        for(int f = 0; f < SITE_FRAMES && s->frames[f] != nullptr; f++)
+            out << (f > 0 ? " < " : "") << nameOf(s->frames[f]);
+        out << endl;
+    }
+    if(lostSites.load(memory_order_relaxed) > 0)
+        out << setw(12) << lostSites.load(memory_order_relaxed) << "  from sites not recorded" << endl;
+#endif
+
+    inTracker = false;
+}
+
+void AllocationTracker::reportLastTick(ostream& out)
+{
+    inTracker = true;
+    out << "Tick " << ticks << " allocations by phase:" << endl;
+    for(int i = 1; i < numPhases; i++)
+    {
+        if(lastTickCount[i] > 0)
+            out << "  " << setw(22) << left << phaseNames[i] << right << setw(12) << lastTickCount[i]
+                << setw(14) << lastTickBytes[i] << endl;
+    }
+    inTracker = false;
+}
+
+// Every allocation made through new, of any form, goes through allocate()
+
+void* operator new(size_t bytes) { return allocate(bytes); }
+void* operator new[](size_t bytes) { return allocate(bytes); }
+void* operator new(size_t bytes, align_val_t a) { return allocateAligned(bytes, a); }
+void* operator new[](size_t bytes, align_val_t a) { return allocateAligned(bytes, a); }
+
+void* operator new(size_t bytes, const nothrow_t&) noexcept
+{
+    try { return allocate(bytes); } catch(const bad_alloc&) { return nullptr; }
+}
+
+void* operator new[](size_t bytes, const nothrow_t&) noexcept
+{
+    try { return allocate(bytes); } catch(const bad_alloc&) { return nullptr; }
+}
+
+void* operator new(size_t bytes, align_val_t a, const nothrow_t&) noexcept
+{
+    try { return allocateAligned(bytes, a); } catch(const bad_alloc&) { return nullptr; }
+}
+
+void* operator new[](size_t bytes, align_val_t a, const nothrow_t&) noexcept
+{
+    try { return allocateAligned(bytes, a); } catch(const bad_alloc&) { return nullptr; }
+}
+
+void operator delete(void* p) noexcept { free(p); }
+void operator delete[](void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+void operator delete[](void* p, size_t) noexcept { free(p); }
+void operator delete(void* p, align_val_t) noexcept { free(p); }
+void operator delete[](void* p, align_val_t) noexcept { free(p); }
+void operator delete(void* p, size_t, align_val_t) noexcept { free(p); }
+void operator delete[](void* p, size_t, align_val_t) noexcept { free(p); }
+void operator delete(void* p, const nothrow_t&) noexcept { free(p); }
+void operator delete[](void* p, const nothrow_t&) noexcept { free(p); }
+void operator delete(void* p, align_val_t, const nothrow_t&) noexcept { free(p); }
+void operator delete[](void* p, align_val_t, const nothrow_t&) noexcept { free(p); }
+
+#else
+
+bool AllocationTracker::enabled() { return false; }
+void AllocationTracker::enterPhase(const char*) {}
+void AllocationTracker::beginTick() {}
+bool AllocationTracker::endTick() { return true; }
+void AllocationTracker::setTickBudget(long long) {}
+void AllocationTracker::report(std::ostream&) {}
+void AllocationTracker::reportLastTick(std::ostream&) {}
+
+#endif
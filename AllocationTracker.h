@@ -0,0 +1,40 @@
+#ifndef ALLOCATIONTRACKER_H_
+#define ALLOCATIONTRACKER_H_
+
+#include <iosfwd>
+
+// Counts heap allocations and their bytes per tick and per phase of a
+// tick, and records the call stacks they came from. Tracking is compiled
+// in only when TRACK_ALLOCATIONS is defined, which replaces the global
+// operator new and delete; without it every function here does nothing.
+// Call sites are found on Linux and macOS; link with -rdynamic to have
+// them named.
+class AllocationTracker
+{
+public:
+    // Is tracking compiled in?
+    static bool enabled();
+
+    // Charges allocations from now on, on any thread, to the phase named
+    // name, until the next call or the end of the tick. Phases are entered
+    // on the thread that runs the ticks; name must outlive the run.
+    static void enterPhase(const char* name);
+
+    // Marks the start of a tick
+    static void beginTick();
+
+    // Marks the end of the tick begun by beginTick, returning false if it
+    // made more allocations than the budget allows
+    static bool endTick();
+
+    // Sets the most allocations one tick may make, or -1 for no limit
+    static void setTickBudget(long long allocations);
+
+    // Prints the totals, the totals by phase and the busiest call sites
+    static void report(std::ostream& out);
+
+    // Prints the allocations of the last tick by phase
+    static void reportLastTick(std::ostream& out);
+};
+
+#endif // ALLOCATIONTRACKER_H_
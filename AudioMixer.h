@@ -0,0 +1,409 @@
+#ifndef AUDIOMIXER_H_
+#define AUDIOMIXER_H_
+
+#include "SpscRing.h"
+#include <vector>
+#include <string>
+#include <memory>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iterator>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+// Where an AudioMixer sends what it mixes: blocks of interleaved stereo
+// 16-bit samples at AudioMixer::RATE
+class AudioSink
+{
+public:
+    virtual ~AudioSink() {}
+
+    // Takes frames frames of samples, two samples (left, right) to a frame
+    virtual void write(const std::int16_t* samples, int frames) = 0;
+
+    // Does write wait for a device to make room, so that the mixer need not
+    // keep time itself?
+    virtual bool keepsTime() const
+    {
+        return false;
+    }
+};
+
+// Throws away what it is given, counting the frames
+class NullSink : public AudioSink
+{
+public:
+    NullSink()
+    : frames(0)
+    {}
+
+    void write(const std::int16_t*, int count) override
+    {
+        frames += count;
+    }
+
+    long long getFrames() const
+    {
+        return frames;
+    }
+
+private:
+    long long frames;
+};
+
+// Records what it is given as a 16-bit stereo WAV file, whose header is
+// completed when the sink is destroyed
+class WavFileSink : public AudioSink
+{
+public:
+    WavFileSink(const std::string& path, int rate)
+    : file(path.c_str(), std::ios::binary), rate(rate), frames(0)
+    {
+        writeHeader();
+    }
+
+    ~WavFileSink() override
+    {
+        if(file)
+        {
+            file.seekp(0);
+            writeHeader();
+        }
+    }
+
+    bool isOpen() const
+    {
+        return static_cast<bool>(file);
+    }
+
+    void write(const std::int16_t* samples, int count) override
+    {
+        for(int i = 0; i < 2 * count; i++)
+            put(static_cast<std::uint16_t>(samples[i]), 2);
+        frames += count;
+    }
+
+private:
+    std::ofstream file;
+    int rate;
+    long long frames;
+
+    // little-endian, whatever the machine's order
+    void put(std::uint32_t value, int bytes)
+    {
+        for(int i = 0; i < bytes; i++)
+            file.put(static_cast<char>(value >> (8 * i) & 0xFF));
+    }
+
+    void writeHeader()
+    {
+        std::uint32_t dataBytes = static_cast<std::uint32_t>(frames * 4);
+        file.write("RIFF", 4);
+        put(36 + dataBytes, 4);
+        file.write("WAVEfmt ", 8);
+        put(16, 4);
+        put(1, 2);              // PCM
+        put(2, 2);              // channels
+        put(rate, 4);
+        put(rate * 4, 4);       // bytes a second
+        put(4, 2);              // bytes a frame
+        put(16, 2);             // bits a sample
+        file.write("data", 4);
+        put(dataBytes, 4);
+    }
+};
+
+// Plays sounds decoded once up front by mixing them itself, in the
+// process, into an AudioSink. Sounds are started and stopped through a
+// lock-free queue from one controlling thread; they are mixed either on a
+// thread of the mixer's own, paced in real time, or on demand by mix(),
+// for runs that keep their own time such as headless ones. Up to
+// MAX_VOICES sounds play at once; starting another cuts off the one of
+// lowest priority that has played longest, unless every one playing
+// matters more than the new one, which is then not played.
+class AudioMixer
+{
+public:
+    static const int RATE = 44100;          // frames a second
+    static const int MAX_VOICES = 16;
+    static const int BLOCK_FRAMES = 512;    // mixed at a time, about 12 ms
+
+    AudioMixer()
+    : running(false), nextStart(0), scratch(2 * BLOCK_FRAMES), block(2 * BLOCK_FRAMES)
+    {
+        for(Voice& v : voices)
+            v.sound = -1;
+    }
+
+    ~AudioMixer()
+    {
+        stop();
+    }
+
+    // Sends what is mixed from now on to output, or nowhere for nullptr;
+    // only while not mixing on a thread
+    void setSink(std::unique_ptr<AudioSink> output)
+    {
+        sink = std::move(output);
+    }
+
+    bool hasSink() const
+    {
+        return sink != nullptr;
+    }
+
+    // Decodes the WAV file at path as sound id, returning false if it can't
+    // be read; only while not mixing on a thread
+    bool load(int id, const std::string& path)
+    {
+        if(id < 0)
+            return false;
+        if(id >= static_cast<int>(sounds.size()))
+            sounds.resize(id + 1);
+        return decodeWav(path, sounds[id]);
+    }
+
+    // Starts mixing into the sink on a thread of the mixer's own
+    void start()
+    {
+        stop();
+        if(sink == nullptr)
+            return;
+        running = true;
+        mixer = std::thread([this] { run(); });
+    }
+
+    void stop()
+    {
+        running = false;
+        if(mixer.joinable())
+            mixer.join();
+    }
+
+    // Mixes the next frames frames into the sink on the calling thread;
+    // only while not mixing on a thread
+    void mix(long long frames)
+    {
+        while(frames > 0)
+        {
+            int count = static_cast<int>(std::min<long long>(frames, BLOCK_FRAMES));
+            mixBlock(count);
+            frames -= count;
+        }
+    }
+
+    // Controlling thread: starts sound id from its beginning, returning
+    // false if the queue to the mixer is full
+    bool play(int id, int priority = 0)
+    {
+        Command c = { Command::PLAY, id, priority };
+        return commands.push(c);
+    }
+
+    // Controlling thread: cuts off every sound playing
+    bool stopAll()
+    {
+        Command c = { Command::STOP_ALL, -1, 0 };
+        return commands.push(c);
+    }
+
+    // Prevent copying or assigning AudioMixers
+    AudioMixer(const AudioMixer&) = delete;
+    AudioMixer& operator=(const AudioMixer&) = delete;
+
+private:
+    // interleaved stereo samples at RATE
+    typedef std::vector<std::int16_t> Pcm;
+
+    struct Command
+    {
+        enum Kind { PLAY, STOP_ALL } kind;
+        int sound;
+        int priority;
+    };
+
+    struct Voice
+    {
+        int sound;                  // -1 when free
+        int priority;
+        std::size_t frame;          // next to be mixed
+        unsigned long long started; // order of starting, to find the oldest
+    };
+
+    std::unique_ptr<AudioSink> sink;
+    std::vector<Pcm> sounds;        // by id; empty if not loaded
+    SpscRing<Command, 256> commands;
+    Voice voices[MAX_VOICES];
+    std::atomic<bool> running;
+    std::thread mixer;
+    unsigned long long nextStart;
+    std::vector<std::int32_t> scratch;  // sums of one block, before clipping
+    std::vector<std::int16_t> block;
+
+    void run()
+    {
+        auto blockTime = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::duration<double>(static_cast<double>(BLOCK_FRAMES) / RATE));
+        auto next = std::chrono::steady_clock::now();
+        while(running)
+        {
+            mixBlock(BLOCK_FRAMES);
+            if(!sink->keepsTime())
+            {
+                // a block that was late is not made up for by rushing
+                next = std::max(next + blockTime, std::chrono::steady_clock::now());
+                std::this_thread::sleep_until(next);
+            }
+        }
+    }
+
+    void apply(const Command& c)
+    {
+        if(c.kind == Command::STOP_ALL)
+        {
+            for(Voice& v : voices)
+                v.sound = -1;
+            return;
+        }
+        if(c.sound < 0 || c.sound >= static_cast<int>(sounds.size()) || sounds[c.sound].empty())
+            return;
+
+        Voice* chosen = &voices[0];
+        for(Voice& v : voices)
+        {
+            if(v.sound < 0)
+            {
+                chosen = &v;
+                break;
+            }
+            if(v.priority < chosen->priority ||
+               (v.priority == chosen->priority && v.started < chosen->started))
+                chosen = &v;
+        }
+        if(chosen->sound >= 0 && chosen->priority > c.priority)
+            return;
+        chosen->sound = c.sound;
+        chosen->priority = c.priority;
+        chosen->frame = 0;
+        chosen->started = nextStart++;
+    }
+
+    void mixBlock(int frames)
+    {
+        Command c;
+        while(commands.pop(c))
+            apply(c);
+
+        std::fill(scratch.begin(), scratch.begin() + 2 * frames, 0);
+        for(Voice& v : voices)
+        {
+            if(v.sound < 0)
+                continue;
+            const Pcm& pcm = sounds[v.sound];
+            std::size_t left = pcm.size() / 2 - v.frame;
+            int count = static_cast<int>(std::min<std::size_t>(left, frames));
+            const std::int16_t* from = &pcm[2 * v.frame];
+            for(int i = 0; i < 2 * count; i++)
+                scratch[i] += from[i];
+            v.frame += count;
+            if(v.frame * 2 == pcm.size())
+                v.sound = -1;
+        }
+        for(int i = 0; i < 2 * frames; i++)
+            block[i] = static_cast<std::int16_t>(std::max(-32768, std::min(32767, scratch[i])));
+        if(sink != nullptr)
+            sink->write(&block[0], frames);
+    }
+
+    // Reads a PCM (8, 16, 24 or 32 bits) or 32-bit float WAV file of any
+    // rate and number of channels into pcm, taking the first two channels
+    // (or the only one, twice) and resampling linearly to RATE
+    static bool decodeWav(const std::string& path, Pcm& pcm)
+    {
+        std::ifstream in(path.c_str(), std::ios::binary);
+        std::vector<unsigned char> bytes((std::istreambuf_iterator<char>(in)),
+                                         std::istreambuf_iterator<char>());
+        if(bytes.size() < 12 || std::memcmp(&bytes[0], "RIFF", 4) != 0 || std::memcmp(&bytes[8], "WAVE", 4) != 0)
+            return false;
+
+        auto get = [&](std::size_t at, int n)
+        {
+            std::uint32_t value = 0;
+            for(int i = 0; i < n; i++)
+                value |= static_cast<std::uint32_t>(bytes[at + i]) << (8 * i);
+            return value;
+        };
+
+        int format = 0, channels = 0, rate = 0, bits = 0;
+        std::size_t data = 0, dataBytes = 0;
+        for(std::size_t at = 12; at + 8 <= bytes.size(); )
+        {
+            std::size_t size = get(at + 4, 4);
+            std::size_t body = at + 8;
+            if(size > bytes.size() - body)
+                size = bytes.size() - body;     // a truncated last chunk
+            if(std::memcmp(&bytes[at], "fmt ", 4) == 0 && size >= 16)
+            {
+                format = get(body, 2);
+                channels = get(body + 2, 2);
+                rate = get(body + 4, 4);
+                bits = get(body + 14, 2);
+                if(format == 0xFFFE && size >= 26)
+                    format = get(body + 24, 2);     // WAVE_FORMAT_EXTENSIBLE's sub-format
+            }
+            else if(std::memcmp(&bytes[at], "data", 4) == 0)
+            {
+                data = body;
+                dataBytes = size;
+            }
+            at = body + size + (size & 1);
+        }
+
+        bool isFloat = (format == 3 && bits == 32);
+        if(!(format == 1 && (bits == 8 || bits == 16 || bits == 24 || bits == 32)) && !isFloat)
+            return false;
+        if(channels < 1 || rate < 1 || data == 0)
+            return false;
+
+        int sampleBytes = bits / 8;
+        std::size_t frames = dataBytes / (sampleBytes * channels);
+        auto sample = [&](std::size_t frame, int channel)
+        {
+            std::size_t at = data + (frame * channels + std::min(channel, channels - 1)) * sampleBytes;
+            std::uint32_t raw = get(at, sampleBytes);
+            if(isFloat)
+            {
+                float f;
+                std::memcpy(&f, &raw, sizeof(f));
+                return static_cast<double>(f);
+            }
+            if(bits == 8)
+                return (static_cast<int>(raw) - 128) / 128.0;
+            // sign-extend from the top bit of the sample
+            std::int32_t value = static_cast<std::int32_t>(raw << (32 - bits)) >> (32 - bits);
+            return value / static_cast<double>(1u << (bits - 1));
+        };
+
+        std::size_t outFrames = static_cast<std::size_t>(static_cast<double>(frames) * RATE / rate);
+        pcm.resize(2 * outFrames);
+        for(std::size_t i = 0; i < outFrames; i++)
+        {
+            double at = static_cast<double>(i) * rate / RATE;
+            std::size_t before = static_cast<std::size_t>(at);
+            std::size_t after = std::min(before + 1, frames - 1);
+            double part = at - before;
+            for(int channel = 0; channel < 2; channel++)
+            {
+                double value = sample(before, channel) * (1 - part) + sample(after, channel) * part;
+                value = std::max(-1.0, std::min(1.0, value));
+                pcm[2 * i + channel] = static_cast<std::int16_t>(value * 32767);
+            }
+        }
+        return true;
+    }
+};
+
+#endif // AUDIOMIXER_H_
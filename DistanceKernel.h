@@ -0,0 +1,205 @@
+#ifndef DISTANCEKERNEL_H_
+#define DISTANCEKERNEL_H_
+
+#include "GameConstants.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE4_1__)
+#include <smmintrin.h>
+#endif
+
+// Squared-distance searches over packed positions, each tagged with a
+// byte of category bits. The SIMD versions visit positions in the same
+// order and keep the same ties as the scalar ones, so both give the same
+// answers. They use AVX2 or SSE4.1 only when the compiler targets them,
+// which GCC and Clang need -mavx2, -msse4.1 or -march=native for and
+// MSVC /arch:AVX2; a build without one of those falls back to the scalar
+// searches everywhere.
+
+// Names the searches this build uses, so benchmarks can say which ran
+#if defined(__AVX2__)
+const char* const DISTANCE_KERNEL = "AVX2";
+#elif defined(__SSE4_1__)
+const char* const DISTANCE_KERNEL = "SSE4.1";
+#else
+const char* const DISTANCE_KERNEL = "scalar";
+#endif
+
+// Finds the position i in [0,n) whose category shares a bit with want
+// and whose squared distance to (x,y) is least and below distance. Ties
+// go to the lowest i. Returns i and sets distance to that position's
+// squared distance, or returns -1 and leaves distance alone.
+inline int nearestInCategoryScalar(const Coord* xs, const Coord* ys, const unsigned char* cats, int n,
+                                   Coord x, Coord y, unsigned char want, int& distance)
+{
+    int found = -1;
+    for(int i = 0; i < n; i++)
+    {
+        if((cats[i] & want) == 0)
+            continue;
+        int dx = xs[i] - x;
+        int dy = ys[i] - y;
+        int d = dx*dx + dy*dy;
+        if(d < distance)
+        {
+            distance = d;
+            found = i;
+        }
+    }
+    return found;
+}
+
+#if defined(__AVX2__) || defined(__SSE4_1__)
+namespace distancekernel
+{
+#if defined(__AVX2__)
+    typedef __m256i Lanes;
+    const int LANES = 8;
+
+    inline Lanes splat(int v) { return _mm256_set1_epi32(v); }
+    inline Lanes laneIndices() { return _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7); }
+    inline Lanes add(Lanes a, Lanes b) { return _mm256_add_epi32(a, b); }
+    inline Lanes less(Lanes a, Lanes b) { return _mm256_cmpgt_epi32(b, a); }
+    inline Lanes select(Lanes mask, Lanes a, Lanes b) { return _mm256_blendv_epi8(b, a, mask); }
+    inline void store(int* out, Lanes v) { _mm256_storeu_si256(reinterpret_cast<__m256i*>(out), v); }
+    inline int signMask(Lanes v) { return _mm256_movemask_ps(_mm256_castsi256_ps(v)); }
+
+    // squared distances from (qx,qy) for LANES positions, or INT_MAX-like
+    // "never" where the category does not match
+    inline Lanes distances(const Coord* xs, const Coord* ys, const unsigned char* cats,
+                           Lanes qx, Lanes qy, Lanes want, Lanes never)
+    {
+#ifdef WIDE_COORDS
+        Lanes px = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(xs));
+        Lanes py = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(ys));
+#else
+        Lanes px = _mm256_cvtepi16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(xs)));
+        Lanes py = _mm256_cvtepi16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(ys)));
+#endif
+        Lanes dx = _mm256_sub_epi32(px, qx);
+        Lanes dy = _mm256_sub_epi32(py, qy);
+        Lanes d = _mm256_add_epi32(_mm256_mullo_epi32(dx, dx), _mm256_mullo_epi32(dy, dy));
+        Lanes c = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(cats)));
+        Lanes off = _mm256_cmpeq_epi32(_mm256_and_si256(c, want), _mm256_setzero_si256());
+        return select(off, never, d);
+    }
+#else
+    typedef __m128i Lanes;
+    const int LANES = 4;
+
+    inline Lanes splat(int v) { return _mm_set1_epi32(v); }
+    inline Lanes laneIndices() { return _mm_setr_epi32(0, 1, 2, 3); }
+    inline Lanes add(Lanes a, Lanes b) { return _mm_add_epi32(a, b); }
+    inline Lanes less(Lanes a, Lanes b) { return _mm_cmplt_epi32(a, b); }
+    inline Lanes select(Lanes mask, Lanes a, Lanes b) { return _mm_blendv_epi8(b, a, mask); }
+    inline void store(int* out, Lanes v) { _mm_storeu_si128(reinterpret_cast<__m128i*>(out), v); }
+    inline int signMask(Lanes v) { return _mm_movemask_ps(_mm_castsi128_ps(v)); }
+
+    inline Lanes distances(const Coord* xs, const Coord* ys, const unsigned char* cats,
+                           Lanes qx, Lanes qy, Lanes want, Lanes never)
+    {
+#ifdef WIDE_COORDS
+        Lanes px = _mm_loadu_si128(reinterpret_cast<const __m128i*>(xs));
+        Lanes py = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ys));
+#else
+        Lanes px = _mm_cvtepi16_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(xs)));
+        Lanes py = _mm_cvtepi16_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(ys)));
+#endif
+        Lanes dx = _mm_sub_epi32(px, qx);
+        Lanes dy = _mm_sub_epi32(py, qy);
+        Lanes d = _mm_add_epi32(_mm_mullo_epi32(dx, dx), _mm_mullo_epi32(dy, dy));
+        int bits = cats[0] | cats[1] << 8 | cats[2] << 16 | cats[3] << 24;
+        Lanes c = _mm_cvtepu8_epi32(_mm_cvtsi32_si128(bits));
+        Lanes off = _mm_cmpeq_epi32(_mm_and_si128(c, want), _mm_setzero_si128());
+        return select(off, never, d);
+    }
+#endif
+}
+#endif
+
+// nearestInCategoryScalar, LANES positions at a time. Each lane keeps the
+// first index at its own minimum, so taking the least distance across
+// lanes, and the lowest index among equals, matches the scalar scan.
+inline int nearestInCategory(const Coord* xs, const Coord* ys, const unsigned char* cats, int n,
+                             Coord x, Coord y, unsigned char want, int& distance)
+{
+#if defined(__AVX2__) || defined(__SSE4_1__)
+    using namespace distancekernel;
+    const int NEVER = 0x7FFFFFFF;
+
+    Lanes qx = splat(x), qy = splat(y), wanted = splat(want), never = splat(NEVER);
+    Lanes best = splat(distance);
+    Lanes bestIndex = splat(-1);
+    Lanes index = laneIndices();
+    Lanes step = splat(LANES);
+
+    int blocked = n - n % LANES;
+    for(int first = 0; first < blocked; first += LANES)
+    {
+        Lanes d = distances(xs + first, ys + first, cats + first, qx, qy, wanted, never);
+        Lanes closer = less(d, best);
+        best = select(closer, d, best);
+        bestIndex = select(closer, index, bestIndex);
+        index = add(index, step);
+    }
+
+    int laneBest[LANES], laneIndex[LANES];
+    store(laneBest, best);
+    store(laneIndex, bestIndex);
+
+    int found = -1;
+    for(int l = 0; l < LANES; l++)
+    {
+        if(laneIndex[l] >= 0 &&
+           (laneBest[l] < distance || (laneBest[l] == distance && laneIndex[l] < found)))
+        {
+            distance = laneBest[l];
+            found = laneIndex[l];
+        }
+    }
+
+    // the leftover positions come after every blocked one, so they can
+    // only win with a strictly smaller distance, as in the scalar scan
+    int rest = nearestInCategoryScalar(xs + blocked, ys + blocked, cats + blocked, n - blocked,
+                                       x, y, want, distance);
+    return rest >= 0 ? blocked + rest : found;
+#else
+    return nearestInCategoryScalar(xs, ys, cats, n, x, y, want, distance);
+#endif
+}
+
+// Returns a mask with bit i set if position i, for i in [0,16), is in a
+// category sharing a bit with want and no further than distance from
+// (x,y). The arrays must hold 16 readable entries.
+inline unsigned withinMask(const Coord* xs, const Coord* ys, const unsigned char* cats,
+                           Coord x, Coord y, unsigned char want, int distance)
+{
+#if defined(__AVX2__) || defined(__SSE4_1__)
+    using namespace distancekernel;
+    const int NEVER = 0x7FFFFFFF;
+
+    Lanes qx = splat(x), qy = splat(y), wanted = splat(want), never = splat(NEVER);
+    Lanes limit = splat(distance == NEVER ? NEVER : distance + 1);
+
+    unsigned mask = 0;
+    for(int first = 0; first < 16; first += LANES)
+    {
+        Lanes d = distances(xs + first, ys + first, cats + first, qx, qy, wanted, never);
+        mask |= static_cast<unsigned>(signMask(less(d, limit))) << first;
+    }
+    return mask;
+#else
+    unsigned mask = 0;
+    for(int i = 0; i < 16; i++)
+    {
+        int dx = xs[i] - x;
+        int dy = ys[i] - y;
+        if((cats[i] & want) != 0 && dx*dx + dy*dy <= distance)
+            mask |= 1u << i;
+    }
+    return mask;
+#endif
+}
+
+#endif // DISTANCEKERNEL_H_
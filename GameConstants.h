@@ -3,6 +3,7 @@
 
 #include <random>
 #include <utility>
+#include <cstdint>
 
 // IDs for the game objects
 
@@ -58,6 +59,14 @@ const int SPRITE_HEIGHT = 16;
 const int LEVEL_WIDTH = VIEW_WIDTH / SPRITE_WIDTH;
 const int LEVEL_HEIGHT = VIEW_HEIGHT / SPRITE_HEIGHT;
 
+  // Positions are whole pixels. 16 bits cover the standard levels; build
+  // with WIDE_COORDS for levels too large for that.
+#ifdef WIDE_COORDS
+using Coord = std::int32_t;
+#else
+using Coord = std::int16_t;
+#endif
+
 const double SPRITE_WIDTH_GL = .6; // note - this is tied implicitly to SPRITE_WIDTH due to carey's sloppy openGL programming
 const double SPRITE_HEIGHT_GL = .5; // note - this is tied implicitly to SPRITE_HEIGHT due to carey's sloppy openGL programming
 
@@ -5,11 +5,15 @@
 #include "GraphObject.h"
 #include "SoundFX.h"
 #include "SpriteManager.h"
+#include "AllocationTracker.h"
 #include <string>
 #include <map>
 #include <utility>
 #include <cstdlib>
 #include <algorithm>
+#include <chrono>
+#include <random>
+#include <cmath>
 using namespace std;
 
 /*
@@ -41,7 +45,10 @@ static const double FONT_SCALEDOWN = 760.0;
 static const double SCORE_Y = 3.8;
 static const double SCORE_Z = -10;
 
-static const int MS_PER_FRAME = 5;
+static const int MS_PER_FRAME = 5;     // between steps of the game, by default
+static const int STEPS_PER_TICK = ANIMATION_POSITIONS_PER_TICK + 2;  // a move, then animation
+static const int MS_PER_REDRAW = 16;   // between frames drawn in the window
+static const int CULL_MARGIN = 2 * SPRITE_WIDTH;   // drawn beyond the view, for sprites reaching into it, but clipped to it
 
 struct SpriteInfo
 {
@@ -51,14 +58,13 @@ struct SpriteInfo
 };
 
 static void drawPrompt(string mainMessage, string secondMessage);
-static void drawScoreAndLives(string);
 
 enum GameController::GameControllerState : int {
     welcome, init, makemove, animate, contgame, finishedlevel, cleanup,
     gameover, prompt, quit, not_applicable
 };
 
-void GameController::initDrawersAndSounds()
+void GameController::initDrawers()
 {
     SpriteInfo drawers[] = {
         { IID_PLAYER         , 0, "girl1.tga" },
@@ -81,6 +87,18 @@ void GameController::initDrawersAndSounds()
         { IID_WALL           , 0, "wall.tga" },
     };
 
+    string path = m_gw->assetPath();
+    for (const SpriteInfo& d : drawers)
+    {
+        if (!m_spriteManager.loadSprite(path + d.tgaFileName, d.imageID, d.frameNum))
+            exit(1);
+    }
+    if (!m_spriteManager.buildAtlas())
+        exit(1);
+}
+
+void GameController::initSounds()
+{
     SoundMapType::value_type sounds[] = {
         make_pair(SOUND_PLAYER_FIRE     , "flame.wav"),
         make_pair(SOUND_PLAYER_DIE      , "die.wav"),
@@ -96,19 +114,24 @@ void GameController::initDrawersAndSounds()
         make_pair(SOUND_THEME           , "theme.wav"),
     };
 
-    string path = m_gw->assetPath();
-    for (const SpriteInfo& d : drawers)
+    for (const auto& s : sounds)
+        m_soundMap[s.first] = m_gw->assetPath() + s.second;
+
+      // the mixer decodes every sound now, so playing one later only
+      // queues a command to it
+    if (m_mixer.hasSink())
     {
-        if (!m_spriteManager.loadSprite(path + d.tgaFileName, d.imageID, d.frameNum))
-            exit(1);
+        for (const auto& s : sounds)
+        {
+            if (!m_mixer.load(s.first, m_soundMap[s.first]))
+                cerr << "Cannot load " << s.second << "; it will not be heard" << endl;
+        }
     }
-    for (const auto& s : sounds)
-        m_soundMap[s.first] = s.second;
 }
 
-static void doSomethingCallback()
+static void renderCallback()
 {
-    Game().doSomething();
+    Game().render();
 }
 
 static void reshapeCallback(int w, int h)
@@ -128,8 +151,8 @@ static void specialKeyboardEventCallback(int key, int x, int y)
 
 static void timerFuncCallback(int)
 {
-    Game().doSomething();
-    glutTimerFunc(MS_PER_FRAME, timerFuncCallback, 0);
+    Game().render();
+    glutTimerFunc(MS_PER_REDRAW, timerFuncCallback, 0);
 }
 
 void GameController::run(int argc, char* argv[], GameWorld* gw, string windowTitle)
@@ -137,10 +160,17 @@ void GameController::run(int argc, char* argv[], GameWorld* gw, string windowTit
     gw->setController(this);
     m_gw = gw;
     setGameState(welcome);
-    m_lastKeyHit = INVALID_KEY;
+    m_input.clear();
+    m_inputLatency.reset();
+    m_ticksPlayed = 0;
+    m_keyTick = -1;
     m_singleStep = false;
+    m_quitRequested = false;
+    m_gameFinished = false;
+    m_headless = false;
     m_curIntraFrameTick = 0;
     m_playerWon = false;
+    m_gameStatVersion = 0;
 
     glutInit(&argc, argv);
 
@@ -149,32 +179,187 @@ void GameController::run(int argc, char* argv[], GameWorld* gw, string windowTit
     glutInitWindowPosition(0, 0);
     glutCreateWindow(windowTitle.c_str());
 
-    initDrawersAndSounds();
+    initDrawers();
+    initSounds();
+    m_mixer.start();
 
     glutKeyboardFunc(keyboardEventCallback);
     glutSpecialFunc(specialKeyboardEventCallback);
     glutReshapeFunc(reshapeCallback);
-    glutDisplayFunc(doSomethingCallback);
-    glutTimerFunc(MS_PER_FRAME, timerFuncCallback, 0);
+    glutDisplayFunc(renderCallback);
+    glutTimerFunc(MS_PER_REDRAW, timerFuncCallback, 0);
+
+      // the game plays on a thread of its own and publishes snapshots of
+      // what to draw; this thread only draws them, so neither a slow frame
+      // nor a slow tick holds up the other
+    m_gameThread = thread([this] { runGame(); });
 
     glutSetOption(GLUT_ACTION_ON_WINDOW_CLOSE, GLUT_ACTION_GLUTMAINLOOP_RETURNS);
     glutMainLoop();
+    quitGame();
+    m_gameThread.join();
+    for (GLuint list : m_staticLayers)
+        glDeleteLists(list, 1);
+    m_gameStatLine.release();
+    m_mixer.stop();
+    m_mixer.setSink(nullptr);
+    m_inputLatency.report(cout, m_input.getDropped());
+    delete m_gw;
+}
+
+void GameController::setTicksPerSecond(int ticks)
+{
+    m_msPerStep = (ticks > 0 ? max(1, 1000 / (ticks * STEPS_PER_TICK)) : 0);
+}
+
+int GameController::playTick()
+{
+    int status = m_gw->move();
+    m_gw->flushSounds();
+    m_ticksPlayed++;
+    return status;
+}
+
+  // FNV-1a over the world's counters and then each object in scene order
+unsigned long long GameController::hashState() const
+{
+    unsigned long long hash = 14695981039346656037ULL;
+    auto mix = [&hash](long long value)
+    {
+        for (int i = 0; i < 8; i++)
+        {
+            hash ^= static_cast<unsigned long long>(value >> (8 * i)) & 0xFF;
+            hash *= 1099511628211ULL;
+        }
+    };
+    mix(m_gw->getScore());
+    mix(m_gw->getLives());
+    mix(m_gw->getLevel());
+    m_gw->getScene().forEachObject([&mix](int imageID, Coord x, Coord y, Direction dir)
+    {
+        mix(imageID);
+        mix(x);
+        mix(y);
+        mix(dir);
+    });
+    return hash;
+}
+
+double GameController::tickSeconds() const
+{
+    return STEPS_PER_TICK * (m_msPerStep > 0 ? m_msPerStep : MS_PER_FRAME) / 1000.0;
+}
+
+void GameController::runGame()
+{
+    chrono::milliseconds step(m_msPerStep > 0 ? m_msPerStep : MS_PER_FRAME);
+    chrono::steady_clock::time_point next = chrono::steady_clock::now();
+    while (m_gameState != quit)
+    {
+        doSomething();
+          // a step that ran long is not made up for by rushing the next ones
+        next = max(next + step, chrono::steady_clock::now());
+        this_thread::sleep_until(next);
+    }
+    doSomething();
+    m_gameFinished = true;
+}
+
+bool GameController::runHeadless(GameWorld* gw, int maxTicks)
+{
+    gw->setController(this);
+    m_gw = gw;
+    m_gameState = makemove;
+    m_input.clear();
+    m_inputLatency.reset();
+    m_ticksPlayed = 0;
+    m_keyTick = -1;
+    m_singleStep = false;
+    m_quitRequested = false;
+    m_headless = true;
+    m_playerWon = false;
+    m_gameStatVersion = 0;
+
+    initSounds();
+
+    int ticks = 0;
+    long long framesMixed = 0;
+    bool withinBudget = true;
+    int status = m_gw->init();
+    while (ticks < maxTicks  &&  !m_quitRequested)
+    {
+        if (status == GWSTATUS_PLAYER_WON)
+        {
+            m_playerWon = true;
+            break;
+        }
+        if (status == GWSTATUS_LEVEL_ERROR)
+            break;
+
+        AllocationTracker::beginTick();
+        status = playTick();
+        ticks++;
+        if (m_mixer.hasSink())
+        {
+            long long frames = llround(ticks * tickSeconds() * AudioMixer::RATE);
+            m_mixer.mix(frames - framesMixed);
+            framesMixed = frames;
+        }
+        if (!AllocationTracker::endTick())
+        {
+            withinBudget = false;
+            cout << "Over the allocation budget" << endl;
+            AllocationTracker::reportLastTick(cout);
+            break;
+        }
+        if (status == GWSTATUS_PLAYER_DIED)
+        {
+            if (m_gw->isGameOver())
+                break;
+            m_gw->cleanUp();
+            status = m_gw->init();
+        }
+        else if (status == GWSTATUS_FINISHED_LEVEL)
+        {
+            m_gw->advanceToNextLevel();
+            m_gw->cleanUp();
+            status = m_gw->init();
+        }
+    }
+    m_stateHash = hashState();
+    m_gw->cleanUp();
+
+    cout << "Seed: " << m_gw->getRandomSeed()
+         << " Threads: " << m_gw->getWorkerThreads()
+         << " Ticks: " << ticks
+         << " Level: " << m_gw->getLevel()
+         << " Lives: " << m_gw->getLives()
+         << " Score: " << m_gw->getScore()
+         << (m_playerWon ? " (won)" : "")
+         << " State: " << hex << m_stateHash << dec << endl;
+    m_inputLatency.report(cout, m_input.getDropped());
+    if (AllocationTracker::enabled())
+        AllocationTracker::report(cout);
+    m_mixer.setSink(nullptr);
     delete m_gw;
+    return withinBudget;
 }
 
+  // keys are queued for the game thread; the ones that change how the
+  // game is run rather than what Penelope does take effect at once
 void GameController::keyboardEvent(unsigned char key, int /* x */, int /* y */)
 {
     switch (key)
     {
-        case 'a': case '4': m_lastKeyHit = KEY_PRESS_LEFT;  break;
-        case 'd': case '6': m_lastKeyHit = KEY_PRESS_RIGHT; break;
-        case 'w': case '8': m_lastKeyHit = KEY_PRESS_UP;    break;
-        case 's': case '2': m_lastKeyHit = KEY_PRESS_DOWN;  break;
-        case 't':           m_lastKeyHit = KEY_PRESS_TAB;   break;
+        case 'a': case '4': m_input.post(KEY_PRESS_LEFT);   break;
+        case 'd': case '6': m_input.post(KEY_PRESS_RIGHT);  break;
+        case 'w': case '8': m_input.post(KEY_PRESS_UP);     break;
+        case 's': case '2': m_input.post(KEY_PRESS_DOWN);   break;
+        case 't':           m_input.post(KEY_PRESS_TAB);    break;
         case 'f':           m_singleStep = true;            break;
         case 'r':           m_singleStep = false;           break;
         case 'q': case 'Q': quitGame();                     break;
-        default:            m_lastKeyHit = key;             break;
+        default:            m_input.post(key);              break;
     }
 }
 
@@ -182,16 +367,50 @@ void GameController::specialKeyboardEvent(int key, int /* x */, int /* y */)
 {
     switch (key)
     {
-        case GLUT_KEY_LEFT:  m_lastKeyHit = KEY_PRESS_LEFT;  break;
-        case GLUT_KEY_RIGHT: m_lastKeyHit = KEY_PRESS_RIGHT; break;
-        case GLUT_KEY_UP:    m_lastKeyHit = KEY_PRESS_UP;    break;
-        case GLUT_KEY_DOWN:  m_lastKeyHit = KEY_PRESS_DOWN;  break;
-        default:             m_lastKeyHit = INVALID_KEY;     break;
+        case GLUT_KEY_LEFT:  m_input.post(KEY_PRESS_LEFT);  break;
+        case GLUT_KEY_RIGHT: m_input.post(KEY_PRESS_RIGHT); break;
+        case GLUT_KEY_UP:    m_input.post(KEY_PRESS_UP);    break;
+        case GLUT_KEY_DOWN:  m_input.post(KEY_PRESS_DOWN);  break;
+        default:                                            break;
     }
 }
 
-void GameController::playSound(int soundID)
+  // a replay may itself be recorded, so the keys replayed are recorded too
+bool GameController::getKeyForTick(int& value)
 {
+    if (m_inputLog.isReplaying())
+    {
+        if (!m_inputLog.keyFor(m_ticksPlayed, value))
+            return false;
+    }
+    else
+    {
+        InputEvent e;
+        if (m_keyTick == m_ticksPlayed  ||  !m_input.take(e))
+            return false;
+        m_keyTick = m_ticksPlayed;
+        m_inputLatency.add(chrono::steady_clock::now() - e.at);
+        value = e.key;
+    }
+    if (m_inputLog.isRecording())
+        m_inputLog.add(m_ticksPlayed, value);
+    return true;
+}
+
+void GameController::playSound(int soundID, int priority)
+{
+    if (m_mixer.hasSink())
+    {
+        if (soundID == SOUND_NONE)
+            m_mixer.stopAll();
+        else
+            m_mixer.play(soundID, priority);
+        return;
+    }
+
+    if (m_headless)
+        return;
+
     if (soundID == SOUND_NONE)
     {
         SoundFX().abortClip();
@@ -200,7 +419,7 @@ void GameController::playSound(int soundID)
 
     SoundMapType::const_iterator p = m_soundMap.find(soundID);
     if (p != m_soundMap.end())
-        SoundFX().playClip(m_gw->assetPath() + p->second);
+        SoundFX().playClip(p->second);
 }
 
 void GameController::setGameState(GameControllerState s)
@@ -220,11 +439,14 @@ void GameController::setGameStateAfterPrompting(GameControllerState s,
 
 void GameController::quitGame()
 {
-    setGameState(quit);
+    m_quitRequested = true;
 }
 
 void GameController::doSomething()
 {
+    if (m_quitRequested)
+        setGameState(quit);
+
     switch (m_gameState)
     {
         case not_applicable:
@@ -236,7 +458,7 @@ void GameController::doSomething()
         case init:
             {
                 int status = m_gw->init();
-                SoundFX().abortClip();
+                playSound(SOUND_NONE);
                 if (status == GWSTATUS_PLAYER_WON)
                 {
                     m_playerWon = true;
@@ -256,7 +478,7 @@ void GameController::doSomething()
             m_curIntraFrameTick = ANIMATION_POSITIONS_PER_TICK;
             m_nextStateAfterAnimate = not_applicable;
             {
-                int status = m_gw->move();
+                int status = playTick();
                 if (status == GWSTATUS_PLAYER_DIED)
                 {
                       // animate one last frame so the player can see what happened
@@ -269,10 +491,10 @@ void GameController::doSomething()
                     m_nextStateAfterAnimate = finishedlevel;
                 }
             }
+            publishGamePlay();
             setGameState(animate);
             break;
         case animate:
-            displayGamePlay();
             if (m_curIntraFrameTick-- <= 0)
             {
                 if (m_nextStateAfterAnimate != not_applicable)
@@ -307,7 +529,7 @@ void GameController::doSomething()
             }
             break;
         case prompt:
-            drawPrompt(m_mainMessage, m_secondMessage);
+            publishPrompt();
             {
                 int key;
                 if (getLastKey(key) && key == '\r')
@@ -315,13 +537,107 @@ void GameController::doSomething()
             }
             break;
         case quit:
-            SoundFX().abortClip();
-            glutLeaveMainLoop();
+            playSound(SOUND_NONE);
             break;
     }
 }
 
-void GameController::displayGamePlay()
+void GameController::publishGamePlay()
+{
+    RenderSnapshot& snapshot = m_snapshots.writeBuffer();
+    snapshot.prompt = false;
+    if (snapshot.gameStatVersion != m_gameStatVersion)
+    {
+        snapshot.gameStatText = m_gameStatText;
+        snapshot.gameStatVersion = m_gameStatVersion;
+    }
+
+    Scene& scene = m_gw->getScene();
+    snapshot.publishedAt = chrono::steady_clock::now();
+    snapshot.tickSeconds = tickSeconds();
+
+    auto recordInto = [](vector<SpriteRecord>& records)
+    {
+        return [&records](int imageID, int animationNumber, double fromX, double fromY,
+                          double x, double y, int angle, double size, int depth)
+        {
+            SpriteRecord r = { imageID, animationNumber, fromX, fromY, x, y, angle, size, depth };
+            records.push_back(r);
+        };
+    };
+
+      // the view follows the focus of the scene, centered on it but kept
+      // within the map, and eases from where it was a tick before just as
+      // the focus does
+    double focusFromX = 0, focusFromY = 0, focusX = 0, focusY = 0;
+    scene.getFocus(focusFromX, focusFromY, focusX, focusY);
+    auto cameraFor = [](double focus, int sceneSize, int viewSize)
+    {
+        double corner = focus + SPRITE_WIDTH / 2 - viewSize / 2;
+        return max(0.0, min(corner, static_cast<double>(max(0, sceneSize - viewSize))));
+    };
+    snapshot.cameraFromX = cameraFor(focusFromX, scene.getWidth(), VIEW_WIDTH);
+    snapshot.cameraFromY = cameraFor(focusFromY, scene.getHeight(), VIEW_HEIGHT);
+    snapshot.cameraX = cameraFor(focusX, scene.getWidth(), VIEW_WIDTH);
+    snapshot.cameraY = cameraFor(focusY, scene.getHeight(), VIEW_HEIGHT);
+
+      // only the scene's buckets that the view passes over this tick are
+      // visited, so a frame costs the same however large the map
+    int left = static_cast<int>(min(snapshot.cameraFromX, snapshot.cameraX)) - CULL_MARGIN;
+    int bottom = static_cast<int>(min(snapshot.cameraFromY, snapshot.cameraY)) - CULL_MARGIN;
+    int right = static_cast<int>(max(snapshot.cameraFromX, snapshot.cameraX)) + VIEW_WIDTH + CULL_MARGIN;
+    int top = static_cast<int>(max(snapshot.cameraFromY, snapshot.cameraY)) + VIEW_HEIGHT + CULL_MARGIN;
+
+    snapshot.sprites.clear();
+    scene.drawDynamicIn(left, bottom, right, top, recordInto(snapshot.sprites));
+
+      // each buffer keeps the static objects of every bucket it was last
+      // given, so a bucket in view is copied only when the buffer's copy
+      // of it is out of date
+    snapshot.staticInView.clear();
+    scene.forEachBucketIn(left, bottom, right, top, [&](int bucket)
+    {
+        if (bucket >= static_cast<int>(snapshot.staticBuckets.size()))
+            snapshot.staticBuckets.resize(bucket + 1);
+        StaticBucket& b = snapshot.staticBuckets[bucket];
+        if (b.version != scene.getStaticVersion(bucket))
+        {
+            b.sprites.clear();
+            scene.drawStaticBucket(bucket, recordInto(b.sprites));
+            b.version = scene.getStaticVersion(bucket);
+        }
+        snapshot.staticInView.push_back(bucket);
+    });
+
+    m_snapshots.publish();
+}
+
+void GameController::publishPrompt()
+{
+    RenderSnapshot& snapshot = m_snapshots.writeBuffer();
+    snapshot.prompt = true;
+    snapshot.mainMessage = m_mainMessage;
+    snapshot.secondMessage = m_secondMessage;
+    m_snapshots.publish();
+}
+
+void GameController::render()
+{
+    if (m_gameFinished)
+    {
+        glutLeaveMainLoop();
+        return;
+    }
+
+    m_snapshots.update();
+    const RenderSnapshot& snapshot = m_snapshots.readBuffer();
+    if (snapshot.prompt)
+        drawPrompt(snapshot.mainMessage, snapshot.secondMessage);
+    else
+        displayGamePlay(snapshot);
+}
+
+void GameController::displayGamePlay(const RenderSnapshot& snapshot)
 {
     glEnable(GL_DEPTH_TEST); // must be done each time before displaying graphics or gets disabled for some reason
     glLoadIdentity();
@@ -335,14 +651,66 @@ void GameController::displayGamePlay()
 #pragma GCC diagnostic pop
 #endif
 
-    GraphObject::drawAllObjects(
-        [=](int imageID, int animationNumber, double x, double y, int angle, double size)
+      // sprites are drawn part of the way from where they were a tick
+      // before the snapshot to where it left them, the part growing with
+      // the time since it was published, so motion stays smooth however
+      // few ticks a second are played
+    double alpha = 1;
+    if (snapshot.tickSeconds > 0)
+    {
+        chrono::duration<double> since = chrono::steady_clock::now() - snapshot.publishedAt;
+        alpha = min(1.0, since.count() / snapshot.tickSeconds);
+    }
+
+    auto queue = [this, alpha](const SpriteRecord* records, size_t count)
+    {
+        for (const SpriteRecord* r = records; r != records + count; r++)
+        {
+            int frame = r->animationNumber % m_spriteManager.getNumFrames(r->imageID);
+            double x = r->fromX + (r->x - r->fromX) * alpha;
+            double y = r->fromY + (r->y - r->fromY) * alpha;
+            m_spriteManager.queueSprite(r->imageID, frame, x, y, r->direction, r->size, r->depth);
+        }
+    };
+
+      // whatever lies in the cull margin is drawn only as far as it
+      // reaches into the view, so it neither spills over the window's
+      // margins and the score line nor pops in at the margin's edge
+    SpriteManager::scissorToView();
+    glEnable(GL_SCISSOR_TEST);
+    glPushMatrix();
+    SpriteManager::scrollTo(snapshot.cameraFromX + (snapshot.cameraX - snapshot.cameraFromX) * alpha,
+                            snapshot.cameraFromY + (snapshot.cameraY - snapshot.cameraFromY) * alpha);
+
+      // the walls, exits and pits of each bucket of the scene are drawn
+      // into a display list of their own when they first come into view or
+      // a pit opens there, and the lists in view are replayed under
+      // everything else
+    for (int bucket : snapshot.staticInView)
+    {
+        const StaticBucket& b = snapshot.staticBuckets[bucket];
+        if (bucket >= static_cast<int>(m_staticLayers.size()))
+        {
+            m_staticLayers.resize(bucket + 1, 0);
+            m_staticLayerVersions.resize(bucket + 1, 0);
+        }
+        if (m_staticLayers[bucket] == 0)
+            m_staticLayers[bucket] = glGenLists(1);
+        if (m_staticLayerVersions[bucket] != b.version)
         {
-            int frame = animationNumber % m_spriteManager.getNumFrames(imageID);
-            m_spriteManager.plotSprite(imageID, frame, x, y, angle, size);
-        });
+            queue(b.sprites.data(), b.sprites.size());
+            m_spriteManager.compileQueued(m_staticLayers[bucket]);
+            m_staticLayerVersions[bucket] = b.version;
+        }
+        glCallList(m_staticLayers[bucket]);
+    }
+
+    queue(snapshot.sprites.data(), snapshot.sprites.size());
+    m_spriteManager.drawQueued();
+    glPopMatrix();
+    glDisable(GL_SCISSOR_TEST);
 
-    drawScoreAndLives(m_gameStatText);
+    drawScoreAndLives(snapshot.gameStatText, snapshot.gameStatVersion);
 
     glutSwapBuffers();
 }
@@ -402,14 +770,18 @@ static void drawPrompt(string mainMessage, string secondMessage)
     glutSwapBuffers();
 }
 
-static void drawScoreAndLives(string gameStatText)
+void GameController::drawScoreAndLives(const string& gameStatText, unsigned int version)
 {
-    static int RATE = 1;
+      // the color wanders a little each frame; its random numbers come
+      // from a generator of the drawing thread's own
+    static const int RATE = 1;
+    static minstd_rand jitter;
+    static uniform_int_distribution<int> step(-RATE, RATE);
     static GLfloat rgb[3] =
         { static_cast<GLfloat>(.6), static_cast<GLfloat>(.6), static_cast<GLfloat>(.6) };
     for (int k = 0; k < 3; k++)
     {
-        double strength = rgb[k] + randInt(-RATE, RATE) / 100.0;
+        double strength = rgb[k] + step(jitter) / 100.0;
         if (strength < .6)
             strength = .6;
         else if (strength > 1.0)
@@ -417,5 +789,5 @@ static void drawScoreAndLives(string gameStatText)
         rgb[k] = static_cast<GLfloat>(strength);
     }
     glColor3f(rgb[0], rgb[1], rgb[2]);
-    outputStrokeCentered(SCORE_Y, SCORE_Z, gameStatText.c_str());
+    m_gameStatLine.draw(gameStatText, version, SCORE_Y, SCORE_Z, FONT_SCALEDOWN);
 }
@@ -2,10 +2,18 @@
 #define GAMECONTROLLER_H_
 
 #include "SpriteManager.h"
+#include "TripleBuffer.h"
+#include "HudText.h"
+#include "AudioMixer.h"
+#include "InputQueue.h"
 #include <string>
 #include <map>
+#include <vector>
 #include <iostream>
 #include <sstream>
+#include <thread>
+#include <atomic>
+#include <chrono>
 
 const int INVALID_KEY = 0;
 
@@ -17,26 +25,84 @@ class GameController
   public:
     void run(int argc, char* argv[], GameWorld* gw, std::string windowTitle);
 
+      // Sets how many ticks a second run() plays; the window is redrawn at
+      // its own rate, easing sprites between ticks
+    void setTicksPerSecond(int ticks);
+
+      // Plays up to maxTicks ticks with no window or keyboard, and no sound
+      // unless it has a sink, then reports where the game got to. Returns
+      // false if a tick went over the allocation budget, which ends the
+      // run there.
+    bool runHeadless(GameWorld* gw, int maxTicks);
+
+      // A hash of the state the last headless run left the world in: its
+      // score, lives and level and every object's image, place and
+      // direction. Runs that play out the same end with the same hash.
+    unsigned long long getStateHash() const
+    {
+        return m_stateHash;
+    }
+
+      // Plays sounds through the in-process mixer into sink instead of
+      // through the platform's own player; set before run or runHeadless.
+      // A headless run then mixes each tick's worth of sound as it plays
+      // the tick, so what a sink records doesn't depend on how fast the
+      // run went.
+    void setSoundSink(std::unique_ptr<AudioSink> sink)
+    {
+        m_mixer.setSink(std::move(sink));
+    }
+
+      // Writes the keys the world acts on, and the ticks it acts on them
+      // in, to the file at path as the game is played, along with the
+      // settings it is played with; set before run or runHeadless.
+      // Returns false if the file can't be written.
+    bool recordInput(const std::string& path, const PlaySettings& settings)
+    {
+        return m_inputLog.record(path, settings);
+    }
+
+      // Gives the world the keys recorded in the file at path, in the
+      // ticks they were recorded in, instead of the keyboard's; settings
+      // is set to those the recording was made with, which the world must
+      // be given for the game to play out the same. Returns false if the
+      // file can't be read.
+    bool replayInput(const std::string& path, PlaySettings& settings)
+    {
+        return m_inputLog.replay(path, settings);
+    }
+
+      // Takes the oldest key press waiting, for the controller's own use
+      // between ticks: prompts and single stepping
     bool getLastKey(int& value)
     {
-        if (m_lastKeyHit != INVALID_KEY)
-        {
-            value = m_lastKeyHit;
-            m_lastKeyHit = INVALID_KEY;
-            return true;
-        }
-        return false;
+        InputEvent e;
+        if (!m_input.take(e))
+            return false;
+        value = e.key;
+        return true;
     }
 
-    void playSound(int soundID);
+      // Takes the key the world acts on in the tick being played, if any:
+      // at most one a tick, the oldest waiting, or the recorded one when
+      // replaying
+    bool getKeyForTick(int& value);
 
-    void setGameStatText(std::string text)
+      // Plays soundID now, or stops every sound for SOUND_NONE; a sound
+      // of higher priority may cut off one of lower when too many play
+    void playSound(int soundID, int priority = 0);
+
+    void setGameStatText(const std::string& text)
     {
         m_gameStatText = text;
+        m_gameStatVersion++;
     }
 
     void doSomething();
 
+      // Draws the newest snapshot the game has published
+    void render();
+
     void reshape(int w, int h);
     void keyboardEvent(unsigned char key, int x, int y);
     void specialKeyboardEvent(int key, int x, int y);
@@ -53,28 +119,104 @@ class GameController
 private:
     enum GameControllerState : int;
 
+      // One sprite as the game last left it, and where it was a tick before
+    struct SpriteRecord
+    {
+        int     imageID;
+        int     animationNumber;
+        double  fromX;
+        double  fromY;
+        double  x;
+        double  y;
+        int     direction;
+        double  size;
+        int     depth;
+    };
+
+      // The static objects of one bucket of the scene as a snapshot buffer
+      // last copied them, and the static version they show
+    struct StaticBucket
+    {
+        unsigned int version = 0;           // scene versions start at 1
+        std::vector<SpriteRecord> sprites;
+    };
+
+      // Everything render() needs to draw a frame, so that it never looks
+      // at the world while the game thread changes it
+    struct RenderSnapshot
+    {
+        bool        prompt = true;      // a prompt rather than game play
+        std::string mainMessage;
+        std::string secondMessage;
+        std::string gameStatText;
+        unsigned int gameStatVersion = 0;   // controller's, when gameStatText was taken
+        std::vector<SpriteRecord> sprites;          // moving objects in view
+        std::vector<int> staticInView;              // scene buckets in view
+        std::vector<StaticBucket> staticBuckets;    // by scene bucket
+        double      cameraFromX = 0;    // the view's bottom left, eased like a sprite
+        double      cameraFromY = 0;
+        double      cameraX = 0;
+        double      cameraY = 0;
+        std::chrono::steady_clock::time_point publishedAt;
+        double      tickSeconds = 0;    // time the sprites take to get from "from" to here
+    };
+
     GameWorld*          m_gw;
     GameControllerState m_gameState;
     GameControllerState m_nextStateAfterPrompt;
     GameControllerState m_nextStateAfterAnimate;
-    int         m_lastKeyHit;
-    bool        m_singleStep;
+    InputQueue          m_input;            // from the window's callbacks
+    InputLatency        m_inputLatency;     // of the keys the world took
+    InputLog            m_inputLog;
+    long long           m_ticksPlayed;      // moves of the world so far, counting the one in progress
+    long long           m_keyTick;          // the tick the world last took a key in
+    std::atomic<bool>   m_singleStep;
+    std::atomic<bool>   m_quitRequested;    // set by quitGame() from either thread
+    std::atomic<bool>   m_gameFinished;     // the game thread has quit
+    bool        m_headless;
     std::string m_gameStatText;
+    unsigned int m_gameStatVersion; // changes with m_gameStatText
     std::string m_mainMessage;
     std::string m_secondMessage;
     int         m_curIntraFrameTick;
+    int         m_msPerStep;        // between steps of run()'s game thread
     using SoundMapType = std::map<int, std::string>;
     using DrawMapType =  std::map<int, std::string>;
     SoundMapType  m_soundMap;
     bool          m_playerWon;
+    unsigned long long m_stateHash = 0;   // of where the last headless run ended
     SpriteManager m_spriteManager;
+    HudText       m_gameStatLine;         // m_gameStatText as last stroked
+    AudioMixer    m_mixer;                // plays sounds if it has a sink
+    std::vector<GLuint>       m_staticLayers;         // display lists of each bucket's static objects
+    std::vector<unsigned int> m_staticLayerVersions;  // static version of the bucket each shows
+    TripleBuffer<RenderSnapshot> m_snapshots;   // from the game thread to render()
+    std::thread   m_gameThread;           // runs doSomething() in a window
 
     void setGameState(GameControllerState s);
     void setGameStateAfterPrompting(GameControllerState s,
                             std::string mainMessage, std::string secondMessage);
 
-    void initDrawersAndSounds();
-    void displayGamePlay();
+      // Moves the world one tick and plays the sounds it asked for
+    int playTick();
+
+    unsigned long long hashState() const;
+
+    void initDrawers();
+    void initSounds();
+
+      // Seconds one tick takes to play, animation included
+    double tickSeconds() const;
+
+      // Steps the game every MS_PER_FRAME until it quits
+    void runGame();
+
+      // Publish what should be drawn now
+    void publishGamePlay();
+    void publishPrompt();
+
+    void displayGamePlay(const RenderSnapshot& snapshot);
+    void drawScoreAndLives(const std::string& gameStatText, unsigned int version);
 };
 
 inline GameController& Game()
@@ -6,7 +6,7 @@ using namespace std;
 
 bool GameWorld::getKey(int& value)
 {
-    bool gotKey = m_controller->getLastKey(value);
+    bool gotKey = m_controller->getKeyForTick(value);
 
     if (gotKey)
     {
@@ -18,10 +18,18 @@ bool GameWorld::getKey(int& value)
 
 void GameWorld::playSound(int soundID)
 {
-    m_controller->playSound(soundID);
+    m_sounds.add(soundID);
 }
 
-void GameWorld::setGameStatText(string text)
+void GameWorld::flushSounds()
+{
+    m_sounds.flush([this](int soundID, int priority)
+    {
+        m_controller->playSound(soundID, priority);
+    });
+}
+
+void GameWorld::setGameStatText(const string& text)
 {
     m_controller->setGameStatText(text);
 }
@@ -2,6 +2,8 @@
 #define GAMEWORLD_H_
 
 #include "GameConstants.h"
+#include "GraphObject.h"
+#include "SoundBatch.h"
 #include <string>
 
 const int START_PLAYER_LIVES = 3;
@@ -14,7 +16,9 @@ public:
 
     GameWorld(std::string assetPath)
      : m_lives(START_PLAYER_LIVES), m_score(0), m_level(1),
-       m_controller(nullptr), m_assetPath(assetPath)
+       m_controller(nullptr), m_assetPath(assetPath),
+       m_randomSeed(std::random_device()()), m_workerThreads(1),
+       m_typedDispatch(false), m_resortPeriod(0)
     {
     }
 
@@ -26,11 +30,20 @@ public:
     virtual int move() = 0;
     virtual void cleanUp() = 0;
 
-    void setGameStatText(std::string text);
+    void setGameStatText(const std::string& text);
 
     bool getKey(int& value);
+
+      // Sounds asked for during a tick are played when it ends, each at
+      // most once; see SoundBatch
     void playSound(int soundID);
 
+      // The objects this world draws
+    Scene& getScene()
+    {
+        return m_scene;
+    }
+
     int getLevel() const
     {
         return m_level;
@@ -68,6 +81,10 @@ public:
     
       // The following should be used by only the framework, not the student
 
+      // Plays the sounds asked for since the last call; called once
+      // after each move()
+    void flushSounds();
+
     bool isGameOver() const
     {
         return m_lives == 0;
@@ -82,6 +99,53 @@ public:
     {
         m_controller = controller;
     }
+
+      // Seed for the world's random choices; runs with the same seed and
+      // the same input play out the same way
+    void setRandomSeed(unsigned int seed)
+    {
+        m_randomSeed = seed;
+    }
+
+    unsigned int getRandomSeed() const
+    {
+        return m_randomSeed;
+    }
+
+      // Number of threads the world may spread a tick's work over
+    void setWorkerThreads(int n)
+    {
+        m_workerThreads = (n < 1 ? 1 : n);
+    }
+
+    int getWorkerThreads() const
+    {
+        return m_workerThreads;
+    }
+
+      // Whether the world should also keep its actors in one list per
+      // concrete type and run hot loops and queries over those
+    void setTypedDispatch(bool typed)
+    {
+        m_typedDispatch = typed;
+    }
+
+    bool getTypedDispatch() const
+    {
+        return m_typedDispatch;
+    }
+
+      // Ticks between re-sorts of the world's actors into Z-order by
+      // position, or 0 to keep them in the order they joined
+    void setResortPeriod(int ticks)
+    {
+        m_resortPeriod = (ticks < 0 ? 0 : ticks);
+    }
+
+    int getResortPeriod() const
+    {
+        return m_resortPeriod;
+    }
     
 private:
     int m_lives;
@@ -89,6 +153,12 @@ private:
     int m_level;
     GameController* m_controller;
     std::string     m_assetPath;
+    unsigned int    m_randomSeed;
+    int             m_workerThreads;
+    bool            m_typedDispatch;
+    int             m_resortPeriod;
+    Scene           m_scene;
+    SoundBatch      m_sounds;       // asked for during this tick
 };
 
 #endif // GAMEWORLD_H_
@@ -4,13 +4,145 @@
 #include "SpriteManager.h"
 #include "GameConstants.h"
 
-#include <set>
 #include <cmath>
+#include <vector>
+#include <algorithm>
 
 const int ANIMATION_POSITIONS_PER_TICK = 1;
 
 using Direction = int;
 
+class GraphObject;
+
+  // The GraphObjects to be drawn, linked through the objects themselves
+  // so that adding, moving or removing one allocates nothing. Each
+  // GameWorld owns one; objects join it when constructed and leave it
+  // when destroyed. The scene is cut into square buckets BUCKET_SIZE
+  // pixels on a side, and each bucket keeps one list per depth of the
+  // objects whose position lies in it, so drawing a part of a large map
+  // visits only the objects near that part. Static objects, which never
+  // move or change once made, are kept in lists of their own so they can
+  // be drawn once and cached; a bucket's static version changes whenever
+  // one joins or leaves it.
+class Scene
+{
+  public:
+
+    static const int NUM_DEPTHS = 4;
+    static const int BUCKET_SIZE = 4 * SPRITE_WIDTH;
+
+    Scene()
+     : m_lastVersion(0), m_frame(0), m_focus(nullptr)
+    {
+        setBounds(VIEW_WIDTH, VIEW_HEIGHT);
+    }
+
+      // Sizes the scene to width by height pixels; objects outside that
+      // are kept in the nearest bucket along the edge
+    void setBounds(int width, int height);
+
+    int getWidth() const
+    {
+        return m_width;
+    }
+
+    int getHeight() const
+    {
+        return m_height;
+    }
+
+    void add(GraphObject* go);
+    void remove(GraphObject* go);
+
+      // Moves go to the bucket holding its new position, if that changed
+    void moved(GraphObject* go);
+
+      // Names the object the view should follow, or nullptr for none. An
+      // object stops being followed when it is destroyed.
+    void setFocus(const GraphObject* go)
+    {
+        m_focus = go;
+    }
+
+      // Sets (fromX, fromY) and (x, y) as the next draw would pass them
+      // for the followed object, returning false if there is none
+    bool getFocus(double& fromX, double& fromY, double& x, double& y) const;
+
+      // Calls visit(bucket) for each bucket holding positions in the
+      // rectangle from (left, bottom) up to but excluding (right, top)
+    template<typename Func>
+    void forEachBucketIn(int left, int bottom, int right, int top, Func visit) const;
+
+    unsigned int getStaticVersion(int bucket) const
+    {
+        return m_staticVersions[bucket];
+    }
+
+      // Calls visit(imageID, x, y, direction) for every object, a list of
+      // the scene at a time, without drawing or animating any of them
+    template<typename Func>
+    void forEachObject(Func visit) const;
+
+      // Draws the static objects of one bucket from the deepest depth to
+      // the shallowest, each depth in the order its objects joined the
+      // bucket, by calling plotFunc(imageID, animationNumber, fromX,
+      // fromY, x, y, direction, size, depth) for each
+    template<typename Func>
+    void drawStaticBucket(int bucket, Func plotFunc)
+    {
+        for (int depth = NUM_DEPTHS - 1; depth >= 0; depth--)
+            drawList(listIndex(bucket, true, depth), depth, plotFunc);
+    }
+
+      // Draws the moving objects in the buckets forEachBucketIn would
+      // visit, in the same order and with the same plotFunc as
+      // drawStaticBucket, where (fromX, fromY) is where an object was
+      // when last drawn, or where it is now if the last draw passed it
+      // over
+    template<typename Func>
+    void drawDynamicIn(int left, int bottom, int right, int top, Func plotFunc)
+    {
+        for (int depth = NUM_DEPTHS - 1; depth >= 0; depth--)
+        {
+            forEachBucketIn(left, bottom, right, top, [&](int bucket)
+            {
+                drawList(listIndex(bucket, false, depth), depth, plotFunc);
+            });
+        }
+        m_frame++;
+    }
+
+      // Prevent copying or assigning Scenes
+    Scene(const Scene&) = delete;
+    Scene& operator=(const Scene&) = delete;
+
+  private:
+
+      // each bucket's lists of moving objects by depth, then of static ones
+    static const int LISTS_PER_BUCKET = 2 * NUM_DEPTHS;
+
+    int bucketAt(double x, double y) const;
+
+    int listIndex(int bucket, bool isStatic, int depth) const
+    {
+        return bucket * LISTS_PER_BUCKET + depth + (isStatic ? NUM_DEPTHS : 0);
+    }
+
+    template<typename Func>
+    void drawList(int list, int depth, Func& plotFunc);
+
+    int m_width;
+    int m_height;
+    int m_bucketsAcross;
+    int m_bucketsDown;
+    std::vector<GraphObject*>   m_first;    // LISTS_PER_BUCKET per bucket
+    std::vector<GraphObject*>   m_last;
+    std::vector<unsigned int>   m_staticVersions;   // by bucket
+    unsigned int m_lastVersion;     // the newest static version given out
+    unsigned int m_frame;           // draws so far, counting those of moving objects
+    const GraphObject* m_focus;
+};
+
 class GraphObject
 {
   public:
@@ -20,37 +152,42 @@ class GraphObject
     static const int up = 90;
     static const int down = 270;
 
-    GraphObject(int imageID, double startX, double startY, Direction dir = 0, int depth = 0, double size = 1.0)
+    GraphObject(Scene& scene, int imageID, Coord startX, Coord startY, Direction dir = 0, int depth = 0, double size = 1.0)
      : m_imageID(imageID), m_x(startX), m_y(startY), m_destX(startX), m_destY(startY),
-       m_animationNumber(0), m_direction(dir), m_depth(depth), m_size(size)
+       m_animationNumber(0), m_direction(dir), m_depth(depth), m_size(size),
+       m_static(false), m_scene(scene), m_bucket(0), m_drawnFrame(0),
+       m_prev(nullptr), m_next(nullptr)
     {
         if (m_size <= 0)
             m_size = 1;
+        if (m_depth < 0 || m_depth >= Scene::NUM_DEPTHS)
+            m_depth = 0;
 
-        getGraphObjects(m_depth).insert(this);
+        m_scene.add(this);
     }
 
     virtual ~GraphObject()
     {
-        getGraphObjects(m_depth).erase(this);
+        m_scene.remove(this);
     }
 
-    double getX() const
+    Coord getX() const
     {
           // If already moved but not yet animated, use new location anyway.
         return m_destX;
     }
 
-    double getY() const
+    Coord getY() const
     {
           // If already moved but not yet animated, use new location anyway.
         return m_destY;
     }
 
-    virtual void moveTo(double x, double y)
+    virtual void moveTo(Coord x, Coord y)
     {
         m_destX = x;
         m_destY = y;
+        m_scene.moved(this);
         increaseAnimationNumber();
     }
 
@@ -67,6 +204,20 @@ class GraphObject
         m_direction = d % 360;
     }
 
+      // Marks this object as one that will not move or change again
+      // until it is destroyed, so it may be drawn from a cache
+    void setStatic()
+    {
+        m_scene.remove(this);
+        m_static = true;
+        m_scene.add(this);
+    }
+
+    bool isStatic() const
+    {
+        return m_static;
+    }
+
     void setSize(double size)
     {
         m_size = size;
@@ -84,63 +235,165 @@ class GraphObject
         m_animationNumber++;
     }
 
-    template<typename Func>
-    static void drawAllObjects(Func plotFunc)
-    {
-        for (int depth = NUM_DEPTHS - 1; depth >= 0; depth--)
-        {
-            for (GraphObject* go : getGraphObjects(depth))
-            {
-                go->animate();
-                plotFunc(go->m_imageID, go->m_animationNumber, go->m_x, go->m_y, go->m_direction, go->m_size);
-            }
-        }
-    }
-
       // Prevent copying or assigning GraphObjects
     GraphObject(const GraphObject&) = delete;
     GraphObject& operator=(const GraphObject&) = delete;
 
   private:
 
-    static const int NUM_DEPTHS = 4;
+    friend class Scene;
+
     int     m_imageID;
-    double  m_x;
-    double  m_y;
-    double  m_destX;
-    double  m_destY;
+    Coord   m_x;
+    Coord   m_y;
+    Coord   m_destX;
+    Coord   m_destY;
     int     m_animationNumber;
     Direction   m_direction;
     int     m_depth;
     double  m_size;
+    bool    m_static;
+    Scene&  m_scene;
+    int     m_bucket;           // of m_scene, holding it
+    unsigned int    m_drawnFrame;   // the frame of m_scene it was last drawn after
+    GraphObject*    m_prev;     // neighbours in the same list of m_scene
+    GraphObject*    m_next;
 
+      // Takes the position moved to since the last animation as the one
+      // shown; the renderer eases between the two
     void animate()
     {
         m_x = m_destX;
         m_y = m_destY;
-        //moveALittle(m_x, m_destX);
-        //moveALittle(m_y, m_destY);
     }
+};
+
+inline void Scene::setBounds(int width, int height)
+{
+      // take every object out, resize the buckets, and put them back
+    std::vector<GraphObject*> objects;
+    for (size_t list = 0; list < m_first.size(); list++)
+        for (GraphObject* go = m_first[list]; go != nullptr; go = go->m_next)
+            objects.push_back(go);
+
+    m_width = std::max(width, 1);
+    m_height = std::max(height, 1);
+    m_bucketsAcross = (m_width + BUCKET_SIZE - 1) / BUCKET_SIZE;
+    m_bucketsDown = (m_height + BUCKET_SIZE - 1) / BUCKET_SIZE;
+    int numBuckets = m_bucketsAcross * m_bucketsDown;
+    m_first.assign(numBuckets * LISTS_PER_BUCKET, nullptr);
+    m_last.assign(numBuckets * LISTS_PER_BUCKET, nullptr);
+
+      // versions are never reused, so a cache of a bucket from before
+      // can't be mistaken for one of the same number now
+    m_staticVersions.resize(numBuckets);
+    for (int bucket = 0; bucket < numBuckets; bucket++)
+        m_staticVersions[bucket] = ++m_lastVersion;
+
+    for (GraphObject* go : objects)
+        add(go);
+}
+
+inline int Scene::bucketAt(double x, double y) const
+{
+    int across = std::max(0, std::min(m_bucketsAcross - 1, static_cast<int>(std::floor(x / BUCKET_SIZE))));
+    int down = std::max(0, std::min(m_bucketsDown - 1, static_cast<int>(std::floor(y / BUCKET_SIZE))));
+    return down * m_bucketsAcross + across;
+}
+
+inline void Scene::add(GraphObject* go)
+{
+    go->m_bucket = bucketAt(go->m_destX, go->m_destY);
+    int list = listIndex(go->m_bucket, go->m_static, go->m_depth);
+    GraphObject*& last = m_last[list];
+    go->m_prev = last;
+    go->m_next = nullptr;
+    if (last != nullptr)
+        last->m_next = go;
+    else
+        m_first[list] = go;
+    last = go;
+    if (go->m_static)
+        m_staticVersions[go->m_bucket] = ++m_lastVersion;
+}
 
-    void moveALittle(double& from, double& to)
+inline void Scene::remove(GraphObject* go)
+{
+    int list = listIndex(go->m_bucket, go->m_static, go->m_depth);
+    if (go->m_prev != nullptr)
+        go->m_prev->m_next = go->m_next;
+    else
+        m_first[list] = go->m_next;
+    if (go->m_next != nullptr)
+        go->m_next->m_prev = go->m_prev;
+    else
+        m_last[list] = go->m_prev;
+    go->m_prev = go->m_next = nullptr;
+    if (go->m_static)
+        m_staticVersions[go->m_bucket] = ++m_lastVersion;
+    if (go == m_focus)
+        m_focus = nullptr;
+}
+
+inline void Scene::moved(GraphObject* go)
+{
+    if (bucketAt(go->m_destX, go->m_destY) != go->m_bucket)
     {
-        static const double DISTANCE = 1.0/ANIMATION_POSITIONS_PER_TICK;
-        if (to - from >= DISTANCE)
-            from += DISTANCE;
-        else if (from - to >= DISTANCE)
-            from -= DISTANCE;
-        else
-            from = to;
+        const GraphObject* focus = m_focus;
+        remove(go);
+        add(go);
+        m_focus = focus;
     }
+}
 
-    static std::set<GraphObject*>& getGraphObjects(int depth)
+inline bool Scene::getFocus(double& fromX, double& fromY, double& x, double& y) const
+{
+    if (m_focus == nullptr)
+        return false;
+    bool drawnLast = (m_focus->m_drawnFrame == m_frame);
+    fromX = (drawnLast ? m_focus->m_x : m_focus->m_destX);
+    fromY = (drawnLast ? m_focus->m_y : m_focus->m_destY);
+    x = m_focus->m_destX;
+    y = m_focus->m_destY;
+    return true;
+}
+
+template<typename Func>
+void Scene::forEachBucketIn(int left, int bottom, int right, int top, Func visit) const
+{
+    if (right <= left  ||  top <= bottom)
+        return;
+    int first = bucketAt(left, bottom);
+    int last = bucketAt(right - 1, top - 1);
+    for (int down = first / m_bucketsAcross; down <= last / m_bucketsAcross; down++)
+        for (int across = first % m_bucketsAcross; across <= last % m_bucketsAcross; across++)
+            visit(down * m_bucketsAcross + across);
+}
+
+template<typename Func>
+void Scene::forEachObject(Func visit) const
+{
+    for (size_t list = 0; list < m_first.size(); list++)
+        for (const GraphObject* go = m_first[list]; go != nullptr; go = go->m_next)
+            visit(go->m_imageID, go->m_destX, go->m_destY, go->m_direction);
+}
+
+template<typename Func>
+void Scene::drawList(int list, int depth, Func& plotFunc)
+{
+    for (GraphObject* go = m_first[list]; go != nullptr; go = go->m_next)
     {
-        static std::set<GraphObject*> graphObjects[NUM_DEPTHS];
-        if (depth < NUM_DEPTHS)
-            return graphObjects[depth];
-        else
-            return graphObjects[0];     // empty;
+          // an object passed over by the last draw may have moved any
+          // distance since it was last shown, so it is not eased
+        if (go->m_drawnFrame != m_frame)
+            go->animate();
+        go->m_drawnFrame = m_frame + 1;
+        Coord fromX = go->m_x;
+        Coord fromY = go->m_y;
+        go->animate();
+        plotFunc(go->m_imageID, go->m_animationNumber, fromX, fromY, go->m_x, go->m_y,
+                 go->m_direction, go->m_size, depth);
     }
-};
+}
 
 #endif // GRAPHOBJ_H_
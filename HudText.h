@@ -0,0 +1,71 @@
+#ifndef HUDTEXT_H_
+#define HUDTEXT_H_
+
+#include "freeglut.h"
+#include <string>
+
+  // A line of stroked text centered across the window, such as the game
+  // information line. The strokes are recorded in a display list the first
+  // time a text is drawn, and drawing the same text again only replays the
+  // list. The color is not recorded, so it may change from one draw to
+  // the next.
+class HudText
+{
+  public:
+
+    HudText()
+     : m_list(0), m_version(0)
+    {}
+
+      // Draws text centered at height y and depth z, scaled down by
+      // scaleDown from the font's own units. version names the text: it
+      // is stroked again only when the version differs from the last one
+      // drawn, so a new text must come with a new version.
+    void draw(const std::string& text, unsigned int version, double y, double z, double scaleDown)
+    {
+        if (m_list == 0  ||  version != m_version)
+        {
+            if (m_list == 0)
+                m_list = glGenLists(1);
+            glNewList(m_list, GL_COMPILE);
+            stroke(text, y, z, scaleDown);
+            glEndList();
+            m_version = version;
+        }
+        glCallList(m_list);
+    }
+
+      // Frees the display list; the next draw makes a new one
+    void release()
+    {
+        if (m_list != 0)
+            glDeleteLists(m_list, 1);
+        m_list = 0;
+    }
+
+      // Prevent copying or assigning HudTexts
+    HudText(const HudText&) = delete;
+    HudText& operator=(const HudText&) = delete;
+
+  private:
+
+    GLuint       m_list;
+    unsigned int m_version;     // of the text m_list strokes
+
+    static void stroke(const std::string& text, double y, double z, double scaleDown)
+    {
+        const unsigned char* str = reinterpret_cast<const unsigned char*>(text.c_str());
+        double x = -glutStrokeLength(GLUT_STROKE_ROMAN, str) / scaleDown / 2;
+        GLfloat scaledSize = static_cast<GLfloat>(1 / scaleDown);
+        glPushMatrix();
+        glLineWidth(1);
+        glLoadIdentity();
+        glTranslatef(static_cast<GLfloat>(x), static_cast<GLfloat>(y), static_cast<GLfloat>(z));
+        glScalef(scaledSize, scaledSize, scaledSize);
+        for ( ; *str != '\0'; str++)
+            glutStrokeCharacter(GLUT_STROKE_ROMAN, *str);
+        glPopMatrix();
+    }
+};
+
+#endif // HUDTEXT_H_
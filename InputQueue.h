@@ -0,0 +1,248 @@
+#ifndef INPUTQUEUE_H_
+#define INPUTQUEUE_H_
+
+#include "SpscRing.h"
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <ostream>
+#include <utility>
+#include <cctype>
+
+// One key press and when it was made
+struct InputEvent
+{
+    int key;
+    std::chrono::steady_clock::time_point at;
+};
+
+// Key presses from the window's callbacks to the game thread, kept in the
+// order they were made and stamped with when, so a key pressed between
+// ticks is no longer overwritten by the next one. The game takes them
+// oldest first. Only the MAX_WAITING newest presses are kept waiting;
+// older ones are dropped when the game next takes one, so keys mashed
+// or held while the game was busy can't leave it acting on presses long
+// past. If the game takes nothing for long enough for RING_SIZE presses
+// to pile up, further ones are dropped until it does, and counted as
+// dropped too.
+class InputQueue
+{
+public:
+    static const int MAX_WAITING = 4;
+    static const int RING_SIZE = 64;
+
+    InputQueue()
+    : dropped(0), rejected(0)
+    {}
+
+    // Window thread: queues key, stamped now, returning false if it was
+    // dropped because too many are waiting
+    bool post(int key)
+    {
+        InputEvent e = { key, std::chrono::steady_clock::now() };
+        if(events.push(e))
+            return true;
+        rejected.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    // Game thread: takes the oldest press kept waiting into e, returning
+    // false if there is none
+    bool take(InputEvent& e)
+    {
+        InputEvent old;
+        while(events.size() > MAX_WAITING && events.pop(old))
+            dropped++;
+        return events.pop(e);
+    }
+
+    // Game thread: drops every press waiting
+    void clear()
+    {
+        InputEvent old;
+        while(events.pop(old))
+            ;
+    }
+
+    // Presses dropped, by take for being too old or by post for finding
+    // the ring full
+    long long getDropped() const
+    {
+        return dropped + rejected.load(std::memory_order_relaxed);
+    }
+
+private:
+    SpscRing<InputEvent, RING_SIZE> events;
+    long long dropped;                      // by take, on the game thread
+    std::atomic<long long> rejected;        // by post, on the window thread
+};
+
+// How long key presses waited before the game acted on them, kept as a
+// histogram of whole milliseconds so that recording one allocates nothing
+class InputLatency
+{
+public:
+    InputLatency()
+    {
+        reset();
+    }
+
+    void reset()
+    {
+        for(long long& n : counts)
+            n = 0;
+        total = 0;
+        sumMs = 0;
+        maxMs = 0;
+    }
+
+    void add(std::chrono::steady_clock::duration waited)
+    {
+        double ms = std::chrono::duration<double, std::milli>(waited).count();
+        int bucket = static_cast<int>(ms);
+        counts[bucket < 0 ? 0 : (bucket < MAX_MS ? bucket : MAX_MS)]++;
+        total++;
+        sumMs += ms;
+        if(ms > maxMs)
+            maxMs = ms;
+    }
+
+    // Prints the number of presses and their mean and longest waits, and
+    // the whole milliseconds under which half and 95% of them waited, if
+    // any were recorded
+    void report(std::ostream& out, long long dropped) const
+    {
+        if(total == 0 && dropped == 0)
+            return;
+        out << "Input: " << total << " keys acted on, " << dropped << " dropped";
+        if(total > 0)
+        {
+            out << "; waited " << sumMs / total << " ms on average, half under "
+                << percentile(50) << " ms, 95% under " << percentile(95) << " ms, "
+                << maxMs << " ms at most";
+        }
+        out << std::endl;
+    }
+
+private:
+    static const int MAX_MS = 1000;     // the last bucket holds every longer wait
+
+    long long counts[MAX_MS + 1];
+    long long total;
+    double sumMs;
+    double maxMs;
+
+    // the upper edge of the bucket holding the given percentile, in ms
+    int percentile(int percent) const
+    {
+        long long wanted = (total * percent + 99) / 100;
+        long long seen = 0;
+        for(int ms = 0; ms <= MAX_MS; ms++)
+        {
+            seen += counts[ms];
+            if(seen >= wanted)
+                return ms + 1;
+        }
+        return MAX_MS + 1;
+    }
+};
+
+// What decides how a game plays out besides the keys it is given: the
+// world's seed and how often it re-sorts its actors, which changes the
+// order they meet each other in. The number of threads and the dispatch
+// mode never change a game.
+struct PlaySettings
+{
+    unsigned int seed = 0;
+    int resortPeriod = 0;
+};
+
+// The keys the game acted on and the tick each was acted on in, written
+// to a file as they are taken or read back from one to play them again.
+// With the same settings a replay takes the same keys in the same ticks,
+// so it plays out exactly as the recorded game did, with or without a
+// window. The file starts with the lines "seed N" and "resort N" and then
+// has a line "tick key" for each key.
+class InputLog
+{
+public:
+    InputLog()
+    : recording(false), replaying(false), next(0)
+    {}
+
+    // Starts recording into the file at path, for a game played with the
+    // given settings; returns false if it can't be written
+    bool record(const std::string& path, const PlaySettings& settings)
+    {
+        out.open(path.c_str());
+        if(!out)
+            return false;
+        out << "seed " << settings.seed << "\n";
+        out << "resort " << settings.resortPeriod << "\n";
+        recording = true;
+        return true;
+    }
+
+    // Reads the recording at path to replay it, setting settings to those
+    // it was made with; returns false if it can't be read or names a
+    // setting this game doesn't know, which it then couldn't replay
+    bool replay(const std::string& path, PlaySettings& settings)
+    {
+        std::ifstream in(path.c_str());
+        std::string word;
+        if(!(in >> word >> settings.seed) || word != "seed")
+            return false;
+        settings.resortPeriod = 0;      // recordings from before it was kept
+        while(in >> std::ws && std::isalpha(in.peek()))
+        {
+            if(!(in >> word) || word != "resort" || !(in >> settings.resortPeriod))
+                return false;
+        }
+        long long tick;
+        int key;
+        while(in >> tick >> key)
+            keys.push_back(std::make_pair(tick, key));
+        replaying = true;
+        next = 0;
+        return true;
+    }
+
+    bool isRecording() const
+    {
+        return recording;
+    }
+
+    bool isReplaying() const
+    {
+        return replaying;
+    }
+
+    // Notes that key was acted on in tick
+    void add(long long tick, int key)
+    {
+        out << tick << " " << key << "\n";
+    }
+
+    // Sets key to the key the recording acted on in tick, if any; ticks
+    // must be asked about in increasing order
+    bool keyFor(long long tick, int& key)
+    {
+        while(next < keys.size() && keys[next].first < tick)
+            next++;
+        if(next == keys.size() || keys[next].first != tick)
+            return false;
+        key = keys[next++].second;
+        return true;
+    }
+
+private:
+    bool recording;
+    bool replaying;
+    std::ofstream out;
+    std::vector<std::pair<long long, int>> keys;    // (tick, key), being replayed
+    std::size_t next;                               // index in keys of the next one
+};
+
+#endif // INPUTQUEUE_H_
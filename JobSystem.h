@@ -0,0 +1,348 @@
+#ifndef JOBSYSTEM_H_
+#define JOBSYSTEM_H_
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <memory>
+
+// A small work-stealing scheduler for the independent pieces of a tick.
+// Each thread keeps its own queue of ready jobs, runs the newest one it
+// queued, and when it runs dry takes the oldest job from another thread's
+// queue. A job may name jobs it depends on; it is queued only once they
+// have all finished. The thread that owns the system helps run jobs while
+// it waits, so with one thread everything runs on the caller.
+//
+// Jobs don't own what they run: submit takes the callable by reference,
+// and it must outlive the job. Jobs, the links between them and the ready
+// queues all live in storage kept from tick to tick, so once it has grown
+// to fit a tick's jobs, submitting and running them allocates nothing.
+class JobSystem
+{
+public:
+    typedef int JobId;      // valid until the next reset()
+
+    JobSystem()
+    : numJobs(0), stopping(false), queued(0)
+    {
+        queues.push_back(std::unique_ptr<Queue>(new Queue));
+    }
+
+    ~JobSystem()
+    {
+        stop();
+    }
+
+    // Uses numThreads threads in all: the caller plus numThreads-1 workers
+    void start(int numThreads)
+    {
+        stop();
+        stopping = false;
+        if(numThreads < 1)
+            numThreads = 1;
+        queues.clear();
+        for(int i = 0; i < numThreads; i++)
+            queues.push_back(std::unique_ptr<Queue>(new Queue));
+        for(int i = 1; i < numThreads; i++)
+            workers.push_back(std::thread([this, i] { workerLoop(i); }));
+    }
+
+    void stop()
+    {
+        {
+            std::lock_guard<std::mutex> lock(sleepMutex);
+            stopping = true;
+        }
+        signal.notify_all();
+        for(size_t i = 0; i < workers.size(); i++)
+            workers[i].join();
+        workers.clear();
+    }
+
+    int getNumThreads() const
+    {
+        return static_cast<int>(workers.size()) + 1;
+    }
+
+    // Index of the calling thread: 0 for the thread that owns the system,
+    // 1 to getNumThreads()-1 for its workers
+    static int threadIndex()
+    {
+        return currentIndex();
+    }
+
+    // Queues f to run on any thread once each of the numDeps jobs in deps
+    // has finished; f is called as f() and must outlive the job
+    template<typename Func>
+    JobId submit(Func& f, const JobId* deps = nullptr, int numDeps = 0)
+    {
+        auto call = [](void* context, int, int)
+        {
+            (*static_cast<Func*>(context))();
+        };
+        return add(call, const_cast<void*>(static_cast<const void*>(&f)), 0, 0, deps, numDeps);
+    }
+
+    // Runs queued jobs on the calling thread until job id has finished
+    void wait(JobId id)
+    {
+        const Job* target;
+        {
+            std::lock_guard<std::mutex> lock(tableMutex);
+            target = &job(id);
+        }
+
+        int me = threadIndex();
+        while(!target->finished)
+        {
+            JobId next;
+            if(take(me, next))
+                runJob(next);
+            else
+            {
+                std::unique_lock<std::mutex> lock(sleepMutex);
+                signal.wait(lock, [&] { return target->finished || queued > 0; });
+            }
+        }
+    }
+
+    // Forgets every job so their storage can be reused. Only call when
+    // everything submitted has been waited for.
+    void reset()
+    {
+        std::lock_guard<std::mutex> lock(tableMutex);
+        numJobs = 0;
+        links.clear();
+    }
+
+    // Calls f(i) for each i in [0, n), split into jobs across the threads,
+    // and returns once every index has been handled. Only the thread that
+    // owns the system may call it.
+    template<typename Func>
+    void parallelFor(int n, Func f)
+    {
+        if(workers.empty() || n <= BATCH)
+        {
+            for(int i = 0; i < n; i++)
+                f(i);
+            return;
+        }
+
+        int chunk = n / (getNumThreads() * 4);
+        if(chunk < BATCH)
+            chunk = BATCH;
+
+        auto callRange = [](void* context, int first, int last)
+        {
+            Func& g = *static_cast<Func*>(context);
+            for(int i = first; i < last; i++)
+                g(i);
+        };
+        parts.clear();
+        for(int first = 0; first < n; first += chunk)
+        {
+            int last = (first + chunk < n ? first + chunk : n);
+            parts.push_back(add(callRange, &f, first, last, nullptr, 0));
+        }
+        for(size_t i = 0; i < parts.size(); i++)
+            wait(parts[i]);
+    }
+
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+private:
+    static const int BATCH = 16;
+    static const int JOBS_PER_BLOCK = 256;
+
+    // runs the job: calls run(context, first, last)
+    typedef void (*Call)(void* context, int first, int last);
+
+    struct Job
+    {
+        Job()
+        : run(nullptr), context(nullptr), first(0), last(0),
+          waitingOn(0), firstDependent(-1), finished(false)
+        {}
+
+        Call run;
+        void* context;
+        int first;
+        int last;
+        int waitingOn;                      // unfinished jobs this one needs
+        int firstDependent;                 // in links, or -1 for none
+        std::atomic<bool> finished;
+    };
+
+    // one job waiting on another, chained from the other's firstDependent
+    struct Link
+    {
+        JobId dependent;
+        int next;                           // in links, or -1 for the last
+    };
+
+    // ready jobs queued by one thread; its owner works from the back and
+    // other threads steal from the front, at head
+    struct Queue
+    {
+        Queue()
+        : head(0)
+        {}
+
+        std::mutex mutex;
+        std::vector<JobId> ready;
+        size_t head;
+    };
+
+    static int& currentIndex()
+    {
+        static thread_local int index = 0;
+        return index;
+    }
+
+    // Only with tableMutex held; a job stays where it is until reset()
+    Job& job(JobId id)
+    {
+        return blocks[id / JOBS_PER_BLOCK][id % JOBS_PER_BLOCK];
+    }
+
+    JobId add(Call run, void* context, int first, int last, const JobId* deps, int numDeps)
+    {
+        JobId id;
+        bool ready;
+        {
+            std::lock_guard<std::mutex> lock(tableMutex);
+            id = numJobs++;
+            if(id / JOBS_PER_BLOCK == static_cast<int>(blocks.size()))
+                blocks.push_back(std::unique_ptr<Job[]>(new Job[JOBS_PER_BLOCK]));
+            Job& j = job(id);
+            j.run = run;
+            j.context = context;
+            j.first = first;
+            j.last = last;
+            j.waitingOn = 0;
+            j.firstDependent = -1;
+            j.finished = false;
+            for(int i = 0; i < numDeps; i++)
+            {
+                Job& d = job(deps[i]);
+                if(!d.finished)
+                {
+                    Link link = { id, d.firstDependent };
+                    d.firstDependent = static_cast<int>(links.size());
+                    links.push_back(link);
+                    j.waitingOn++;
+                }
+            }
+            ready = (j.waitingOn == 0);
+        }
+        if(ready)
+            push(id);
+        return id;
+    }
+
+    void push(JobId id)
+    {
+        Queue& q = *queues[threadIndex()];
+        {
+            std::lock_guard<std::mutex> lock(q.mutex);
+            q.ready.push_back(id);
+        }
+        {
+            std::lock_guard<std::mutex> lock(sleepMutex);
+            queued++;
+        }
+        signal.notify_all();
+    }
+
+    // Takes the newest job from thread me's queue, or else the oldest job
+    // of the first other thread that has one
+    bool take(int me, JobId& id)
+    {
+        int n = static_cast<int>(queues.size());
+        for(int k = 0; k < n; k++)
+        {
+            Queue& q = *queues[(me + k) % n];
+            std::lock_guard<std::mutex> lock(q.mutex);
+            if(q.head == q.ready.size())
+                continue;
+            if(k == 0)
+            {
+                id = q.ready.back();
+                q.ready.pop_back();
+            }
+            else
+                id = q.ready[q.head++];
+            if(q.head == q.ready.size())
+            {
+                q.ready.clear();
+                q.head = 0;
+            }
+            queued--;
+            return true;
+        }
+        return false;
+    }
+
+    void runJob(JobId id)
+    {
+        Job* j;
+        {
+            std::lock_guard<std::mutex> lock(tableMutex);
+            j = &job(id);
+        }
+        j->run(j->context, j->first, j->last);
+
+        {
+            // dependents are queued with the table still locked, which
+            // push allows: it never takes tableMutex itself
+            std::lock_guard<std::mutex> lock(tableMutex);
+            for(int k = j->firstDependent; k >= 0; k = links[k].next)
+            {
+                if(--job(links[k].dependent).waitingOn == 0)
+                    push(links[k].dependent);
+            }
+            j->finished = true;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(sleepMutex);
+        }
+        signal.notify_all();
+    }
+
+    void workerLoop(int index)
+    {
+        currentIndex() = index;
+        for(;;)
+        {
+            JobId id;
+            if(take(index, id))
+            {
+                runJob(id);
+                continue;
+            }
+
+            std::unique_lock<std::mutex> lock(sleepMutex);
+            signal.wait(lock, [this] { return stopping || queued > 0; });
+            if(stopping)
+                return;
+        }
+    }
+
+    std::vector<std::thread> workers;
+    std::vector<std::unique_ptr<Queue>> queues;     // one per thread
+    std::vector<std::unique_ptr<Job[]>> blocks;    // of JOBS_PER_BLOCK jobs; guarded by tableMutex
+    int numJobs;                        // submitted since reset(); guarded by tableMutex
+    std::vector<Link> links;            // guarded by tableMutex
+    std::vector<JobId> parts;           // scratch: parallelFor's jobs
+    std::mutex tableMutex;
+    std::mutex sleepMutex;
+    std::condition_variable signal;     // a job was queued or finished
+    bool stopping;
+    std::atomic<int> queued;            // jobs sitting in a queue
+};
+
+#endif // JOBSYSTEM_H_
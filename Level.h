@@ -5,6 +5,8 @@
 #include <iostream>
 #include <fstream>
 #include <string>
+#include <vector>
+#include <limits>
 #include <cctype>
 
 class Level
@@ -21,45 +23,56 @@ public:
     };
 
     Level(std::string assetPath)
-     : m_assetPath(assetPath)
-    {
-        for (int y = 0; y < LEVEL_HEIGHT; y++)
-            for (int x = 0; x < LEVEL_WIDTH; x++)
-                m_maze[y][x] = empty;
-    }
+     : m_width(0), m_height(0), m_assetPath(assetPath)
+    {}
 
+      // Loads a maze of any size, one line per row from the top, every
+      // row as wide as the first and walled all round
     LoadResult loadLevel(std::string filename)
     {
         std::ifstream levelFile((m_assetPath + filename).c_str());
         if (!levelFile)
             return load_fail_file_not_found;
 
-          // get the maze
+          // get the rows, ignoring trailing blanks
 
+        std::vector<std::string> rows;
         std::string line;
+        size_t lastNonBlank = 0;
+        while (std::getline(levelFile, line))
+        {
+            line.erase(line.find_last_not_of(" \t\r") + 1);
+            rows.push_back(line);
+            if (!line.empty())
+                lastNonBlank = rows.size();
+        }
+        rows.resize(lastNonBlank);
+
+        if (rows.empty())
+            return load_fail_bad_format;
+        m_width = static_cast<int>(rows[0].size());
+        m_height = static_cast<int>(rows.size());
+        if (static_cast<long long>(m_width) * SPRITE_WIDTH > std::numeric_limits<Coord>::max()  ||
+            static_cast<long long>(m_height) * SPRITE_HEIGHT > std::numeric_limits<Coord>::max())
+            return load_fail_bad_format;    // positions wouldn't fit in a Coord
+        m_maze.assign(m_width * m_height, empty);
+
+          // get the maze
+
         bool foundExit = false;
         bool foundPlayer = false;
 
-        for (int y = LEVEL_HEIGHT-1; std::getline(levelFile, line); y--)
+        for (int row = 0; row < m_height; row++)
         {
-            if (y < 0)    // too many maze lines?
-            {
-                if (line.find_first_not_of(" \t\r") != std::string::npos)
-                    return load_fail_bad_format;  // non-blank line
-
-                char dummy;
-                if (levelFile >> dummy)     // non-blank rest of file
-                    return load_fail_bad_format;
-                break;
-            }
-
-            if (line.size() < LEVEL_WIDTH  ||  line.find_first_not_of(" \t\r", LEVEL_WIDTH) != std::string::npos)
+            const std::string& cells = rows[row];
+            if (static_cast<int>(cells.size()) != m_width)
                 return load_fail_bad_format;
-                
-            for (int x = 0; x < LEVEL_WIDTH; x++)
+
+            int y = m_height - 1 - row;
+            for (int x = 0; x < m_width; x++)
             {
-                MazeEntry& me = m_maze[y][x];
-                switch (toupper(line[x]))
+                MazeEntry& me = m_maze[y * m_width + x];
+                switch (toupper(cells[x]))
                 {
                     default:   return load_fail_bad_format;
                     case ' ':  me = empty;                      break;
@@ -83,22 +96,35 @@ public:
         return load_success;
     }
 
+      // The size of the maze loaded, in cells
+    int getWidth() const
+    {
+        return m_width;
+    }
+
+    int getHeight() const
+    {
+        return m_height;
+    }
+
     MazeEntry getContentsOf(int x, int y) const
     {
-        return (x >= 0 && x < LEVEL_WIDTH && y >= 0 && y < LEVEL_HEIGHT) ? m_maze[y][x] : empty;
+        return (x >= 0 && x < m_width && y >= 0 && y < m_height) ? m_maze[y * m_width + x] : empty;
     }
 
 private:
-    MazeEntry   m_maze[LEVEL_HEIGHT][LEVEL_WIDTH];
+    int         m_width;
+    int         m_height;
+    std::vector<MazeEntry> m_maze;  // by row from the bottom
     std::string m_assetPath;
 
     bool edgesValid() const
     {
-        for (int y = 0; y < LEVEL_HEIGHT; y++)
-            if (m_maze[y][0] != wall || m_maze[y][LEVEL_WIDTH-1] != wall)
+        for (int y = 0; y < m_height; y++)
+            if (getContentsOf(0, y) != wall || getContentsOf(m_width-1, y) != wall)
                 return false;
-        for (int x = 0; x < LEVEL_WIDTH; x++)
-            if (m_maze[0][x] != wall || m_maze[LEVEL_HEIGHT-1][x] != wall)
+        for (int x = 0; x < m_width; x++)
+            if (getContentsOf(x, 0) != wall || getContentsOf(x, m_height-1) != wall)
                 return false;
 
         return true;
@@ -0,0 +1,89 @@
+#ifndef OVERLAPKERNEL_H_
+#define OVERLAPKERNEL_H_
+
+#include "GameConstants.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// Two sprites of the same size overlap exactly when their corners are
+// within a sprite's width and height of each other on both axes, which is
+// what StudentWorld::checkBoundaries tests corner by corner. The kernel
+// below makes that test for OVERLAP_BATCH packed positions at once, using
+// AVX2 or SSE2 when the compiler targets them and a plain loop otherwise.
+const int OVERLAP_BATCH = 16;
+
+// Returns a mask with bit i set if the sprite at (xs[i], ys[i]) overlaps
+// the sprite at (x,y), for each i in [0, OVERLAP_BATCH)
+inline unsigned overlapMask(const Coord* xs, const Coord* ys, Coord x, Coord y)
+{
+    const int loX = x - (SPRITE_WIDTH-1), hiX = x + (SPRITE_WIDTH-1);
+    const int loY = y - (SPRITE_HEIGHT-1), hiY = y + (SPRITE_HEIGHT-1);
+
+#if !defined(WIDE_COORDS) && defined(__AVX2__)
+    __m256i px = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(xs));
+    __m256i py = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(ys));
+    __m256i out = _mm256_or_si256(
+        _mm256_or_si256(_mm256_cmpgt_epi16(_mm256_set1_epi16(loX), px),
+                        _mm256_cmpgt_epi16(px, _mm256_set1_epi16(hiX))),
+        _mm256_or_si256(_mm256_cmpgt_epi16(_mm256_set1_epi16(loY), py),
+                        _mm256_cmpgt_epi16(py, _mm256_set1_epi16(hiY))));
+    __m128i bytes = _mm_packs_epi16(_mm256_castsi256_si128(out), _mm256_extracti128_si256(out, 1));
+    return ~static_cast<unsigned>(_mm_movemask_epi8(bytes)) & 0xFFFF;
+#elif !defined(WIDE_COORDS) && defined(__SSE2__)
+    unsigned outside = 0;
+    for(int half = 0; half < 2; half++)
+    {
+        __m128i px = _mm_loadu_si128(reinterpret_cast<const __m128i*>(xs + 8*half));
+        __m128i py = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ys + 8*half));
+        __m128i out = _mm_or_si128(
+            _mm_or_si128(_mm_cmpgt_epi16(_mm_set1_epi16(loX), px),
+                         _mm_cmpgt_epi16(px, _mm_set1_epi16(hiX))),
+            _mm_or_si128(_mm_cmpgt_epi16(_mm_set1_epi16(loY), py),
+                         _mm_cmpgt_epi16(py, _mm_set1_epi16(hiY))));
+        outside |= static_cast<unsigned>(_mm_movemask_epi8(_mm_packs_epi16(out, out)) & 0xFF) << (8*half);
+    }
+    return ~outside & 0xFFFF;
+#elif defined(WIDE_COORDS) && defined(__AVX2__)
+    unsigned outside = 0;
+    for(int half = 0; half < 2; half++)
+    {
+        __m256i px = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(xs + 8*half));
+        __m256i py = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(ys + 8*half));
+        __m256i out = _mm256_or_si256(
+            _mm256_or_si256(_mm256_cmpgt_epi32(_mm256_set1_epi32(loX), px),
+                            _mm256_cmpgt_epi32(px, _mm256_set1_epi32(hiX))),
+            _mm256_or_si256(_mm256_cmpgt_epi32(_mm256_set1_epi32(loY), py),
+                            _mm256_cmpgt_epi32(py, _mm256_set1_epi32(hiY))));
+        outside |= static_cast<unsigned>(_mm256_movemask_ps(_mm256_castsi256_ps(out))) << (8*half);
+    }
+    return ~outside & 0xFFFF;
+#elif defined(WIDE_COORDS) && defined(__SSE2__)
+    unsigned outside = 0;
+    for(int quarter = 0; quarter < 4; quarter++)
+    {
+        __m128i px = _mm_loadu_si128(reinterpret_cast<const __m128i*>(xs + 4*quarter));
+        __m128i py = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ys + 4*quarter));
+        __m128i out = _mm_or_si128(
+            _mm_or_si128(_mm_cmpgt_epi32(_mm_set1_epi32(loX), px),
+                         _mm_cmpgt_epi32(px, _mm_set1_epi32(hiX))),
+            _mm_or_si128(_mm_cmpgt_epi32(_mm_set1_epi32(loY), py),
+                         _mm_cmpgt_epi32(py, _mm_set1_epi32(hiY))));
+        outside |= static_cast<unsigned>(_mm_movemask_ps(_mm_castsi128_ps(out))) << (4*quarter);
+    }
+    return ~outside & 0xFFFF;
+#else
+    unsigned inside = 0;
+    for(int i = 0; i < OVERLAP_BATCH; i++)
+    {
+        if(xs[i] >= loX && xs[i] <= hiX && ys[i] >= loY && ys[i] <= hiY)
+            inside |= 1u << i;
+    }
+    return inside;
+#endif
+}
+
+#endif // OVERLAPKERNEL_H_
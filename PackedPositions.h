@@ -0,0 +1,162 @@
+#ifndef PACKEDPOSITIONS_H_
+#define PACKEDPOSITIONS_H_
+
+#include "OverlapKernel.h"
+#include "DistanceKernel.h"
+#include <vector>
+#include <limits>
+
+// Actor positions and category bits packed by slot, one array each,
+// padded to a whole number of batches with uncategorized positions far
+// off the map that overlap nothing
+class PackedPositions
+{
+public:
+    PackedPositions()
+    : count(0)
+    {}
+
+    void clear()
+    {
+        count = 0;
+        xs.clear();
+        ys.clear();
+        cats.clear();
+    }
+
+    int size() const { return count; }
+
+    // Appends a position with the given category bits and returns its slot
+    int push(Coord x, Coord y, unsigned char categories)
+    {
+        if(count % OVERLAP_BATCH == 0)
+        {
+            xs.resize(count + OVERLAP_BATCH, farAway());
+            ys.resize(count + OVERLAP_BATCH, farAway());
+            cats.resize(count + OVERLAP_BATCH, 0);
+        }
+        xs[count] = x;
+        ys[count] = y;
+        cats[count] = categories;
+        return count++;
+    }
+
+    void set(int slot, Coord x, Coord y)
+    {
+        xs[slot] = x;
+        ys[slot] = y;
+    }
+
+    void setCategories(int slot, unsigned char categories)
+    {
+        cats[slot] = categories;
+    }
+
+    // Moves the last entry into slot and drops the last slot, as
+    // StudentWorld does with its actor list
+    void removeBySwap(int slot)
+    {
+        count--;
+        xs[slot] = xs[count];
+        ys[slot] = ys[count];
+        cats[slot] = cats[count];
+        xs[count] = farAway();
+        ys[count] = farAway();
+        cats[count] = 0;
+    }
+
+    // Rearranges the entries so that slot i holds what slot from[i] held,
+    // for from a permutation of the slots in use
+    void reorder(const std::vector<int>& from)
+    {
+        oldXs.assign(xs.begin(), xs.begin() + count);
+        oldYs.assign(ys.begin(), ys.begin() + count);
+        oldCats.assign(cats.begin(), cats.begin() + count);
+        for(int i = 0; i < count; i++)
+        {
+            xs[i] = oldXs[from[i]];
+            ys[i] = oldYs[from[i]];
+            cats[i] = oldCats[from[i]];
+        }
+    }
+
+    // Calls f(slot) for each position overlapping a sprite at (x,y), in
+    // slot order, stopping and returning true as soon as f does
+    template<typename Func>
+    bool anyOverlapping(Coord x, Coord y, Func f) const
+    {
+        for(int first = 0; first < count; first += OVERLAP_BATCH)
+        {
+            unsigned hits = overlapMask(&xs[first], &ys[first], x, y);
+            if(visitBits(first, hits, f))
+                return true;
+        }
+        return false;
+    }
+
+    // Calls f(slot) in slot order for each position in a category sharing
+    // a bit with want and no further than distance from (x,y)
+    template<typename Func>
+    void forEachWithin(Coord x, Coord y, unsigned char want, int distance, Func f) const
+    {
+        for(int first = 0; first < count; first += OVERLAP_BATCH)
+        {
+            unsigned hits = withinMask(&xs[first], &ys[first], &cats[first], x, y, want, distance);
+            visitBits(first, hits, [&](int slot) { f(slot); return false; });
+        }
+    }
+
+    // Returns the slot of the position in a category sharing a bit with
+    // want that is nearest (x,y) and closer than distance, lowest slot on
+    // ties, setting distance to it; or returns -1
+    int nearest(Coord x, Coord y, unsigned char want, int& distance) const
+    {
+        if(count == 0)
+            return -1;
+        return nearestInCategory(&xs[0], &ys[0], &cats[0], count, x, y, want, distance);
+    }
+
+private:
+    static Coord farAway() { return std::numeric_limits<Coord>::min(); }
+
+    // calls f(first+i) for each set bit i of bits below count, lowest first
+    template<typename Func>
+    bool visitBits(int first, unsigned bits, Func f) const
+    {
+        while(bits != 0)
+        {
+            int i = lowestBit(bits);
+            bits &= bits - 1;
+            if(first + i < count && f(first + i))
+                return true;
+        }
+        return false;
+    }
+
+    static int lowestBit(unsigned bits)
+    {
+#if defined(__GNUC__)
+        return __builtin_ctz(bits);
+#else
+        int i = 0;
+        while((bits & 1) == 0)
+        {
+            bits >>= 1;
+            i++;
+        }
+        return i;
+#endif
+    }
+
+    int count;
+    std::vector<Coord> xs;
+    std::vector<Coord> ys;
+    std::vector<unsigned char> cats;
+
+    // scratch: the entries as they were before reorder
+    std::vector<Coord> oldXs;
+    std::vector<Coord> oldYs;
+    std::vector<unsigned char> oldCats;
+};
+
+#endif // PACKEDPOSITIONS_H_
@@ -0,0 +1,78 @@
+#ifndef PHASESCHEDULER_H_
+#define PHASESCHEDULER_H_
+
+#include <vector>
+#include <algorithm>
+
+class Actor;
+
+// Keeps actors that act every N ticks in N phase buckets, so a tick only
+// visits the bucket whose turn it is. Actors sharing a period are kept
+// together; within a bucket they act in the order they were added.
+class PhaseScheduler
+{
+public:
+    void clear()
+    {
+        groups.clear();
+    }
+
+    // Schedules a to act every period ticks, starting on tick firstTick
+    void add(Actor* a, int period, long long firstTick)
+    {
+        Group& g = groupFor(period);
+        g.phases[firstTick % period].push_back(a);
+    }
+
+    // Appends the actors due on tick t to due, shortest period first
+    void collectDue(long long t, std::vector<Actor*>& due) const
+    {
+        for(size_t i = 0; i < groups.size(); i++)
+        {
+            const std::vector<Actor*>& bucket = groups[i].phases[t % groups[i].period];
+            due.insert(due.end(), bucket.begin(), bucket.end());
+        }
+    }
+
+    // Unschedules every actor gone(a) is true for, keeping the rest in
+    // order; one pass however many are unscheduled
+    template<typename Pred>
+    void removeIf(Pred gone)
+    {
+        for(size_t i = 0; i < groups.size(); i++)
+        {
+            for(size_t p = 0; p < groups[i].phases.size(); p++)
+            {
+                std::vector<Actor*>& bucket = groups[i].phases[p];
+                bucket.erase(std::remove_if(bucket.begin(), bucket.end(), gone), bucket.end());
+            }
+        }
+    }
+
+private:
+    struct Group
+    {
+        int period;
+        std::vector<std::vector<Actor*>> phases;    // one bucket per phase
+    };
+
+    Group& groupFor(int period)
+    {
+        size_t i = 0;
+        while(i < groups.size() && groups[i].period < period)
+            i++;
+
+        if(i == groups.size() || groups[i].period != period)
+        {
+            Group g;
+            g.period = period;
+            g.phases.resize(period);
+            groups.insert(groups.begin() + i, g);
+        }
+        return groups[i];
+    }
+
+    std::vector<Group> groups;      // sorted by period
+};
+
+#endif // PHASESCHEDULER_H_
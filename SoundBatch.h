@@ -0,0 +1,98 @@
+#ifndef SOUNDBATCH_H_
+#define SOUNDBATCH_H_
+
+#include "GameConstants.h"
+
+// The sounds asked for during one tick, held until the tick ends and then
+// played together. A sound asked for many times in a tick, as when a
+// chain of landmines kills a crowd, is played once, and at most
+// MAX_SOUNDS_PER_TICK different sounds are played, the most important
+// first, so what a tick costs to play doesn't grow with what happened in
+// it. Asking for SOUND_NONE drops what was asked for before it in the
+// tick and stops whatever is playing.
+class SoundBatch
+{
+public:
+    static const int MAX_SOUNDS_PER_TICK = 4;
+    static const int MAX_PRIORITY = 4;
+
+    SoundBatch()
+    {
+        clear();
+    }
+
+    void add(int soundID)
+    {
+        if(soundID == SOUND_NONE)
+        {
+            clear();
+            stopFirst = true;
+        }
+        else if(soundID >= 0 && soundID < NUM_SOUNDS)
+            asked[soundID] = true;
+    }
+
+    // Calls play(SOUND_NONE, 0) if playing sounds should be stopped, then
+    // play(soundID, priority) for each sound to be played, the least
+    // important first so that a player that can play only one sound at a
+    // time is left playing the most important, and empties the batch
+    template<typename Func>
+    void flush(Func play)
+    {
+        if(stopFirst)
+            play(SOUND_NONE, 0);
+
+        int chosen[MAX_SOUNDS_PER_TICK];
+        int count = 0;
+        for(int priority = MAX_PRIORITY; priority >= 0 && count < MAX_SOUNDS_PER_TICK; priority--)
+        {
+            for(int id = 0; id < NUM_SOUNDS && count < MAX_SOUNDS_PER_TICK; id++)
+            {
+                if(asked[id] && priorityOf(id) == priority)
+                    chosen[count++] = id;
+            }
+        }
+        while(count > 0)
+        {
+            int id = chosen[--count];
+            play(id, priorityOf(id));
+        }
+        clear();
+    }
+
+    // How much it matters that soundID is heard, from 0 up to
+    // MAX_PRIORITY: what happens to Penelope and the level above what
+    // she does, above what happens to the people she is saving, above
+    // what the zombies do
+    static int priorityOf(int soundID)
+    {
+        switch(soundID)
+        {
+            case SOUND_LEVEL_FINISHED:
+            case SOUND_PLAYER_DIE:          return 4;
+            case SOUND_GOT_GOODIE:
+            case SOUND_CITIZEN_SAVED:
+            case SOUND_LANDMINE_EXPLODE:    return 3;
+            case SOUND_PLAYER_FIRE:
+            case SOUND_CITIZEN_INFECTED:
+            case SOUND_CITIZEN_DIE:         return 2;
+            case SOUND_ZOMBIE_DIE:          return 1;
+            default:                        return 0;
+        }
+    }
+
+private:
+    static const int NUM_SOUNDS = SOUND_THEME + 1;
+
+    bool asked[NUM_SOUNDS];     // by sound ID
+    bool stopFirst;
+
+    void clear()
+    {
+        for(int id = 0; id < NUM_SOUNDS; id++)
+            asked[id] = false;
+        stopFirst = false;
+    }
+};
+
+#endif // SOUNDBATCH_H_
@@ -11,11 +11,21 @@
 #define GL_BGRA GL_BGRA_EXT
 #endif
 
+#ifndef GL_CLAMP_TO_EDGE
+#define GL_CLAMP_TO_EDGE 0x812F
+#endif
+
+#ifndef GL_TEXTURE_MAX_LEVEL
+#define GL_TEXTURE_MAX_LEVEL 0x813D
+#endif
+
 #include "GameConstants.h"
 #include <iostream>
 #include <fstream>
 #include <string>
 #include <map>
+#include <vector>
+#include <algorithm>
 #include <memory>
 #include <cmath>
 
@@ -31,8 +41,27 @@ class SpriteManager
 public:
 
     SpriteManager()
-     : m_mipMapped(true)
+     : m_atlasTexture(0), m_mipMapped(true)
     {
+          // corners of a sprite of size 1 facing each way the game turns
+          // sprites; 180 degrees is a reflection, not a turn
+        const double w = SPRITE_WIDTH_GL / 2;
+        const double h = SPRITE_HEIGHT_GL / 2;
+        for (int d = 0; d < NUM_DIRECTIONS; d++)
+        {
+            int angle = d * 90;
+            double rotationAngle = (angle == 180 ? 0 : angle);
+            DirectionQuad& q = m_directionQuads[d];
+            rotate(-w, -h, rotationAngle, q.x[0], q.y[0]);
+            rotate( w, -h, rotationAngle, q.x[1], q.y[1]);
+            rotate( w,  h, rotationAngle, q.x[2], q.y[2]);
+            rotate(-w,  h, rotationAngle, q.x[3], q.y[3]);
+            if (angle == 180)
+            {
+                std::swap(q.x[0], q.x[1]);
+                std::swap(q.x[2], q.x[3]);
+            }
+        }
     }
 
     bool loadSprite(std::string filename_tga, int imageID, int frameNum)
@@ -74,16 +103,87 @@ public:
         if (byteCount != 3 && byteCount != 4)
             return false;
 
+          // Keep the image, as BGRA, until buildAtlas packs it with the rest
+
+        SpriteImage image;
+        image.spriteID = spriteID;
+        image.width = textureWidth;
+        image.height = textureHeight;
+        image.pixels.resize(textureWidth * textureHeight * 4);
+        for (unsigned int i = 0; i < textureWidth * textureHeight; i++)
+        {
+            for (int c = 0; c < 3; c++)
+                image.pixels[4*i + c] = imageData[byteCount*i + c];
+            image.pixels[4*i + 3] = (byteCount == 4 ? imageData[4*i + 3] : '\xff');
+        }
+        m_images.push_back(std::move(image));
+
+        return true;
+    }
+
+      // Packs every loaded sprite frame into one texture, each frame
+      // surrounded by copies of its edge pixels so that filtering and the
+      // mipmap levels in use never reach into a neighbouring frame
+    bool buildAtlas()
+    {
+        if (m_images.empty())
+            return false;
+
+          // shelves of frames, tallest first, in the narrowest square
+          // power-of-two texture that holds them all
+        std::vector<int> byHeight(m_images.size());
+        for (size_t i = 0; i < byHeight.size(); i++)
+            byHeight[i] = static_cast<int>(i);
+        std::stable_sort(byHeight.begin(), byHeight.end(), [this](int a, int b)
+        {
+            return m_images[a].height > m_images[b].height;
+        });
+
+        GLint maxSize = 0;
+        glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxSize);
+        std::vector<int> cellX(m_images.size()), cellY(m_images.size());
+        int size = 64;
+        while (!packShelves(byHeight, size, cellX, cellY))
+        {
+            size *= 2;
+            if (maxSize > 0  &&  size > maxSize)
+                return false;
+        }
+
+        std::vector<char> atlas(size * size * 4, 0);
+        for (size_t i = 0; i < m_images.size(); i++)
+        {
+            const SpriteImage& image = m_images[i];
+            int w = image.width;
+            int h = image.height;
+            for (int y = -ATLAS_PADDING; y < h + ATLAS_PADDING; y++)
+            {
+                int fromY = std::max(0, std::min(h - 1, y));
+                for (int x = -ATLAS_PADDING; x < w + ATLAS_PADDING; x++)
+                {
+                    int fromX = std::max(0, std::min(w - 1, x));
+                    int to = ((cellY[i] + ATLAS_PADDING + y) * size + cellX[i] + ATLAS_PADDING + x) * 4;
+                    std::copy_n(&image.pixels[(fromY * w + fromX) * 4], 4, &atlas[to]);
+                }
+            }
+
+            if (static_cast<int>(m_frames.size()) <= image.spriteID)
+                m_frames.resize(image.spriteID + 1);
+            AtlasFrame& frame = m_frames[image.spriteID];
+            frame.loaded = true;
+            frame.u0 = static_cast<GLfloat>(cellX[i] + ATLAS_PADDING) / size;
+            frame.v0 = static_cast<GLfloat>(cellY[i] + ATLAS_PADDING) / size;
+            frame.u1 = static_cast<GLfloat>(cellX[i] + ATLAS_PADDING + w) / size;
+            frame.v1 = static_cast<GLfloat>(cellY[i] + ATLAS_PADDING + h) / size;
+        }
+        m_images.clear();
+
           // Transfer Texture To OpenGL
 
         glEnable(GL_DEPTH_TEST);
 
-          // allocate a texture handle
-        GLuint glTextureID;
-        glGenTextures(1, &glTextureID);
-
-          // bind our new texture
-        glBindTexture(GL_TEXTURE_2D, glTextureID);
+        glGenTextures(1, &m_atlasTexture);
+        glBindTexture(GL_TEXTURE_2D, m_atlasTexture);
 
         glTexEnvf(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
 
@@ -93,6 +193,8 @@ public:
             glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
               // when texture area is large, bilinear filter the first mipmap
             glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+              // past this level a texel is wider than the padding
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, ATLAS_MIPMAP_LEVELS);
         }
         else
         {
@@ -100,26 +202,14 @@ public:
             glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
         }
 
-          // Have the texture wrap both vertically and horizontally.
-        glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, static_cast<GLfloat>(GL_REPEAT));
-        glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, static_cast<GLfloat>(GL_REPEAT));
+          // Frames sit inside the atlas, so nothing wraps
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
 
         if (m_mipMapped)
-        {
-              // build our texture mipmaps
-              // byteCount of 3 means that BGR data is being supplied. byteCount of 4 means that BGRA data is being supplied.
-            makeMipmaps(byteCount, textureWidth, textureHeight, imageData.get());
-        }
+            makeMipmaps(4, size, size, &atlas[0]);
         else
-        {
-              // byteCount of 3 means that BGR data is being supplied. byteCount of 4 means that BGRA data is being supplied.
-            if (3 == byteCount)
-                glTexImage2D(GL_TEXTURE_2D, 0, 3, textureWidth, textureHeight, 0, GL_BGR, GL_UNSIGNED_BYTE, imageData.get());
-            else if (4 == byteCount)
-                glTexImage2D(GL_TEXTURE_2D, 0, 4, textureWidth, textureHeight, 0, GL_BGRA, GL_UNSIGNED_BYTE, imageData.get());
-        }
-
-        m_imageMap[spriteID] = glTextureID;
+            glTexImage2D(GL_TEXTURE_2D, 0, 4, size, size, 0, GL_BGRA, GL_UNSIGNED_BYTE, &atlas[0]);
 
         return true;
     }
@@ -133,85 +223,195 @@ public:
         return it->second;
     }
 
-    bool plotSprite(int imageID, int frame, double x, double y, int angleDegrees, double size)
+      // Queues a sprite to be drawn by drawQueued, which draws the sprites
+      // of greater depth first, each depth in the order it was queued
+    bool queueSprite(int imageID, int frame, double x, double y, int angleDegrees, double size, int depth)
     {
-        int spriteID = getSpriteID(imageID, frame);
-        if (spriteID == INVALID_SPRITE_ID)
+        const AtlasFrame* f = findFrame(imageID, frame);
+        if (f == nullptr)
             return false;
 
-        auto it = m_imageMap.find(spriteID);
-        if (it == m_imageMap.end())
-            return false;
+        double gx, gy, gz;
+        convertToGlutCoords(x, y, gx, gy, gz);
 
-        glPushMatrix();
+        DirectionQuad turned;
+        const DirectionQuad* q = &turned;
+        if (angleDegrees % 90 == 0  &&  angleDegrees >= 0  &&  angleDegrees < 360)
+            q = &m_directionQuads[angleDegrees / 90];
+        else
+        {
+            for (int c = 0; c < 4; c++)
+                rotate(m_directionQuads[0].x[c], m_directionQuads[0].y[c], angleDegrees, turned.x[c], turned.y[c]);
+        }
 
-        double finalWidth = SPRITE_WIDTH_GL * size;
-        double finalHeight = SPRITE_HEIGHT_GL * size;
+        const GLfloat u[4] = { f->u0, f->u1, f->u1, f->u0 };
+        const GLfloat v[4] = { f->v0, f->v0, f->v1, f->v1 };
+        for (int c = 0; c < 4; c++)
+        {
+            QuadVertex vertex = { u[c], v[c],
+                                  static_cast<GLfloat>(gx + q->x[c] * size),
+                                  static_cast<GLfloat>(gy + q->y[c] * size),
+                                  static_cast<GLfloat>(gz) };
+            m_queuedVertices.push_back(vertex);
+        }
+        QueuedQuad quad = { depth, static_cast<int>(m_queuedQuads.size()) };
+        m_queuedQuads.push_back(quad);
+        return true;
+    }
 
-        // object's x/y location is center-based, but sprite plotting is upper-left-corner based
-        const double xoffset = 0;// finalWidth / 2;
-        const double yoffset = 0;// finalHeight / 2;
+      // Draws and forgets the queued sprites: one vertex array from the
+      // atlas, sorted by depth, drawn with one call
+    void drawQueued()
+    {
+        std::sort(m_queuedQuads.begin(), m_queuedQuads.end());
 
-        double gx, gy, gz;
-        convertToGlutCoords(x, y, gx, gy, gz);
-        glTranslatef(static_cast<GLfloat>(gx-xoffset),static_cast<GLfloat>(gy-yoffset),static_cast<GLfloat>(gz));
-        glPushAttrib(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        m_sortedVertices.resize(m_queuedVertices.size());
+        for (size_t i = 0; i < m_queuedQuads.size(); i++)
+            std::copy_n(&m_queuedVertices[4 * m_queuedQuads[i].order], 4, &m_sortedVertices[4 * i]);
+
+        glPushAttrib(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_ENABLE_BIT);
+        glPushClientAttrib(GL_CLIENT_VERTEX_ARRAY_BIT);
         glEnable(GL_TEXTURE_2D);
         glDisable(GL_DEPTH_TEST);
-        glEnable (GL_BLEND);
+        glEnable(GL_BLEND);
         glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-        glBindTexture(GL_TEXTURE_2D, it->second);
-
         glColor3f(1.0, 1.0, 1.0);
 
-        double cx1 = 0, cy1 = 0;
-        double cx2 = 1, cy2 = 0;
-        double cx3 = 1, cy3 = 1;
-        double cx4 = 0, cy4 = 1;
-
-          // Rotate sprite.  For 180 degrees, don't rotate, but reflect
-        double rx1, ry1, rx2, ry2, rx3, ry3, rx4, ry4;
-        double rotationAngle = (angleDegrees == 180 ? 0 : angleDegrees);
-        rotate(-finalWidth / 2, -finalHeight / 2, rotationAngle, rx1, ry1);
-        rotate( finalWidth / 2, -finalHeight / 2, rotationAngle, rx2, ry2);
-        rotate( finalWidth / 2,  finalHeight / 2, rotationAngle, rx3, ry3);
-        rotate(-finalWidth / 2,  finalHeight / 2, rotationAngle, rx4, ry4);
-        if (angleDegrees == 180)
+        if (!m_sortedVertices.empty())
         {
-            // No rotation happened, but reflect to face left
-            std::swap(rx1, rx2);
-            std::swap(rx3, rx4);
+            glBindTexture(GL_TEXTURE_2D, m_atlasTexture);
+            glInterleavedArrays(GL_T2F_V3F, 0, &m_sortedVertices[0]);
+            glDrawArrays(GL_QUADS, 0, static_cast<GLsizei>(m_sortedVertices.size()));
         }
 
-        glBegin(GL_QUADS);
-        glTexCoord2d(cx1, cy1);
-        glVertex3f(static_cast<GLfloat>(rx1), static_cast<GLfloat>(ry1), 0);
-        glTexCoord2d(cx2, cy2);
-        glVertex3f(static_cast<GLfloat>(rx2), static_cast<GLfloat>(ry2), 0);
-        glTexCoord2d(cx3, cy3);
-        glVertex3f(static_cast<GLfloat>(rx3), static_cast<GLfloat>(ry3), 0);
-        glTexCoord2d(cx4, cy4);
-        glVertex3f(static_cast<GLfloat>(rx4), static_cast<GLfloat>(ry4), 0);
-        glEnd();
-
-        glDisable(GL_TEXTURE_2D);
-        glEnable(GL_DEPTH_TEST);
-
+        glPopClientAttrib();
         glPopAttrib();
-        glPopMatrix();
 
-        return true;
+        m_queuedVertices.clear();
+        m_queuedQuads.clear();
+    }
+
+      // Shifts everything drawn after it, until the modelview matrix is
+      // next reset, so that the game's position (x, y) shows at the bottom
+      // left corner of the view
+    static void scrollTo(double x, double y)
+    {
+        double gx, gy, gz, originX, originY;
+        convertToGlutCoords(x, y, gx, gy, gz);
+        convertToGlutCoords(0, 0, originX, originY, gz);
+        glTranslated(originX - gx, originY - gy, 0);
+    }
+
+      // Sets the scissor box to the window pixels the view covers, found by
+      // projecting its corners through the matrices as they are before any
+      // scrolling, so nothing drawn under it spills past the view
+    static void scissorToView()
+    {
+        GLdouble modelview[16], projection[16];
+        GLint viewport[4];
+        glGetDoublev(GL_MODELVIEW_MATRIX, modelview);
+        glGetDoublev(GL_PROJECTION_MATRIX, projection);
+        glGetIntegerv(GL_VIEWPORT, viewport);
+
+        double gx[2], gy[2], gz, wx[2], wy[2], wz;
+        convertToGlutCoords(0, 0, gx[0], gy[0], gz);
+        convertToGlutCoords(VIEW_WIDTH, VIEW_HEIGHT, gx[1], gy[1], gz);
+        for (int i = 0; i < 2; i++)
+        {
+#ifdef _MSC_VER
+            gluProject(gx[i], gy[i], gz, modelview, projection, viewport, &wx[i], &wy[i], &wz);
+#else
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wdeprecated-declarations"
+            gluProject(gx[i], gy[i], gz, modelview, projection, viewport, &wx[i], &wy[i], &wz);
+#pragma GCC diagnostic pop
+#endif
+        }
+
+        int left = std::max(viewport[0], static_cast<int>(std::floor(wx[0])));
+        int bottom = std::max(viewport[1], static_cast<int>(std::floor(wy[0])));
+        int right = std::min(viewport[0] + viewport[2], static_cast<int>(std::ceil(wx[1])));
+        int top = std::min(viewport[1] + viewport[3], static_cast<int>(std::ceil(wy[1])));
+        glScissor(left, bottom, std::max(0, right - left), std::max(0, top - bottom));
+    }
+
+      // Draws and forgets the queued sprites as drawQueued would, but into
+      // the display list named list, replacing what it held
+    void compileQueued(GLuint list)
+    {
+        glNewList(list, GL_COMPILE);
+        drawQueued();
+        glEndList();
     }
 
     ~SpriteManager()
     {
-        for (auto it = m_imageMap.begin(); it != m_imageMap.end(); it++)
-            glDeleteTextures(1, &it->second);
+        if (m_atlasTexture != 0)
+            glDeleteTextures(1, &m_atlasTexture);
     }
 
 private:
 
-    std::map<int, GLuint>   m_imageMap;
+    static const int NUM_DIRECTIONS = 4;
+
+      // corners of a sprite of size 1 relative to its center, in GL units
+    struct DirectionQuad
+    {
+        double x[4];
+        double y[4];
+    };
+
+      // one corner as glInterleavedArrays(GL_T2F_V3F, ...) reads it
+    struct QuadVertex
+    {
+        GLfloat u, v;
+        GLfloat x, y, z;
+    };
+
+      // a queued sprite: drawn after any of greater depth, and after
+      // any of the same depth queued before it
+    struct QueuedQuad
+    {
+        int     depth;
+        int     order;      // queue position; its corners start at 4*order
+
+        bool operator<(const QueuedQuad& other) const
+        {
+            if (depth != other.depth)
+                return depth > other.depth;
+            return order < other.order;
+        }
+    };
+
+      // a loaded frame waiting for buildAtlas, as BGRA rows from the bottom
+    struct SpriteImage
+    {
+        int spriteID;
+        int width;
+        int height;
+        std::vector<char> pixels;
+    };
+
+      // where a frame sits in the atlas, in texture coordinates
+    struct AtlasFrame
+    {
+        bool    loaded = false;
+        GLfloat u0, v0;
+        GLfloat u1, v1;
+    };
+
+      // texels of edge copies around each frame in the atlas, and the
+      // mipmap levels whose texels are no wider than that
+    static const int ATLAS_PADDING = 4;
+    static const int ATLAS_MIPMAP_LEVELS = 2;
+
+    DirectionQuad           m_directionQuads[NUM_DIRECTIONS];
+    std::vector<QuadVertex> m_queuedVertices;
+    std::vector<QuadVertex> m_sortedVertices;
+    std::vector<QueuedQuad> m_queuedQuads;
+    std::vector<SpriteImage> m_images;      // loaded, not yet in the atlas
+    std::vector<AtlasFrame> m_frames;       // by sprite ID
+    GLuint                  m_atlasTexture;
     std::map<int, int>      m_frameCountPerSprite;
     bool                    m_mipMapped;
 
@@ -227,6 +427,42 @@ private:
         return imageID * MAX_FRAMES_PER_SPRITE + frame;
     }
 
+    const AtlasFrame* findFrame(int imageID, int frame) const
+    {
+        int spriteID = getSpriteID(imageID, frame);
+        if (spriteID == INVALID_SPRITE_ID  ||  spriteID >= static_cast<int>(m_frames.size())  ||
+            !m_frames[spriteID].loaded)
+            return nullptr;
+
+        return &m_frames[spriteID];
+    }
+
+      // Places the images in order on shelves across a square texture of
+      // the given size, each in a cell with padding on every side; returns
+      // false if they don't fit
+    bool packShelves(const std::vector<int>& order, int size, std::vector<int>& cellX, std::vector<int>& cellY) const
+    {
+        int x = 0, y = 0, shelfHeight = 0;
+        for (int i : order)
+        {
+            int w = m_images[i].width + 2 * ATLAS_PADDING;
+            int h = m_images[i].height + 2 * ATLAS_PADDING;
+            if (x + w > size)
+            {
+                x = 0;
+                y += shelfHeight;
+                shelfHeight = 0;
+            }
+            if (x + w > size  ||  y + h > size)
+                return false;
+            cellX[i] = x;
+            cellY[i] = y;
+            x += w;
+            shelfHeight = std::max(shelfHeight, h);
+        }
+        return true;
+    }
+
     static void rotate(double x, double y, double degrees, double &xout, double &yout)
     {
         static const double PI = 4 * atan(1.0);
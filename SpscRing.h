@@ -0,0 +1,75 @@
+#ifndef SPSCRING_H_
+#define SPSCRING_H_
+
+#include <atomic>
+#include <cstddef>
+
+// A bounded queue from one producing thread to one consuming thread that
+// never locks or allocates. The producer only writes the tail and the
+// consumer only writes the head, so each side needs just one atomic load
+// of the other's index. CAPACITY must be a power of two; the queue holds
+// up to CAPACITY values, and push fails rather than wait when it is full.
+template<typename T, std::size_t CAPACITY>
+class SpscRing
+{
+    static_assert(CAPACITY > 0 && (CAPACITY & (CAPACITY - 1)) == 0,
+                  "SpscRing capacity must be a power of two");
+
+public:
+    SpscRing()
+    : head(0), tail(0)
+    {}
+
+    // Producer: appends value, returning false if the queue is full
+    bool push(const T& value)
+    {
+        std::size_t t = tail.load(std::memory_order_relaxed);
+        if(t - head.load(std::memory_order_acquire) == CAPACITY)
+            return false;
+        slots[t & (CAPACITY - 1)] = value;
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer: takes the oldest value into value, returning false if the
+    // queue is empty
+    bool pop(T& value)
+    {
+        std::size_t h = head.load(std::memory_order_relaxed);
+        if(tail.load(std::memory_order_acquire) == h)
+            return false;
+        value = slots[h & (CAPACITY - 1)];
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer: the oldest value, or nullptr if the queue is empty; it
+    // stays queued until pop
+    const T* peek() const
+    {
+        std::size_t h = head.load(std::memory_order_relaxed);
+        if(tail.load(std::memory_order_acquire) == h)
+            return nullptr;
+        return &slots[h & (CAPACITY - 1)];
+    }
+
+    // Either side: how many values are queued, which may be out of date
+    // by the time it returns
+    std::size_t size() const
+    {
+        return tail.load(std::memory_order_acquire) - head.load(std::memory_order_acquire);
+    }
+
+    // Prevent copying or assigning SpscRings
+    SpscRing(const SpscRing&) = delete;
+    SpscRing& operator=(const SpscRing&) = delete;
+
+private:
+    // the indices only ever grow, and wrap around together; each sits on
+    // a cache line of its own so the two threads don't contend for one
+    alignas(64) std::atomic<std::size_t> head;     // next slot to pop
+    alignas(64) std::atomic<std::size_t> tail;     // next slot to push
+    T slots[CAPACITY];
+};
+
+#endif // SPSCRING_H_
@@ -3,10 +3,12 @@
 #include "GameWorld.h"
 #include "Level.h"
 #include "Actor.h"
+#include "AllocationTracker.h"
 #include <string>
 #include <vector>
-#include <sstream>
-#include <iomanip>
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
 using namespace std;
 
 GameWorld* createStudentWorld(string assetPath)
@@ -16,7 +18,11 @@ GameWorld* createStudentWorld(string assetPath)
 
 
 StudentWorld::StudentWorld(string assetPath)
-: GameWorld(assetPath), penelope(nullptr), numCitizens(0)
+: GameWorld(assetPath), penelope(nullptr), numCitizens(0),
+  gridWidth(LEVEL_WIDTH), gridHeight(LEVEL_HEIGHT),
+  typedDispatch(false), resortPeriod(0), lastResort(0),
+  agentSeedCount(0), statusShown(false),
+  sightCache(1 << SIGHT_CACHE_BITS)
 {}
 
 StudentWorld::~StudentWorld()
@@ -28,6 +34,19 @@ StudentWorld::~StudentWorld()
 int StudentWorld::init()
 {
     numCitizens = 0;
+    agentSeedCount = 0;
+    statusShown = false;
+    for(size_t i = 0; i < sightCache.size(); i++)
+        sightCache[i].store(0, memory_order_relaxed);
+    
+    if(jobs.getNumThreads() != getWorkerThreads())
+        jobs.start(getWorkerThreads());
+    commands.resize(jobs.getNumThreads());
+    typedDispatch = getTypedDispatch();
+    resortPeriod = getResortPeriod();
+    lastResort = 0;
+    actorLists.clear();
+    timers.reset(0);
 
     // load level
     Level lev(assetPath());
@@ -48,10 +67,19 @@ int StudentWorld::init()
     else if (result == Level::load_success)
     {
         cerr << "Successfully loaded level" << endl;
+        
+        // levels may be larger than the view, which follows penelope
+        gridWidth = lev.getWidth();
+        gridHeight = lev.getHeight();
+        wallCells.assign(gridWidth * gridHeight, false);
+        contactGrid.reset(gridWidth, gridHeight);
+        agentGrid.reset(gridWidth, gridHeight);
+        getScene().setBounds(gridWidth * SPRITE_WIDTH, gridHeight * SPRITE_HEIGHT);
+        
         Level::MazeEntry ge;
-        for(int x = 0; x < 16; x++)
+        for(int x = 0; x < gridWidth; x++)
         {
-            for(int y = 0; y < 16; y++)
+            for(int y = 0; y < gridHeight; y++)
             {
                 // go through level file and add respective actors
                 ge = lev.getContentsOf(x,y);
@@ -62,44 +90,46 @@ int StudentWorld::init()
                         break;
                     case Level::player:
                         cerr << "Location " << x << " " << y << " is where Penelope starts" << endl;
-                        penelope = new Penelope(this, x*LEVEL_WIDTH,y*LEVEL_HEIGHT);
+                        penelope = new Penelope(this, x*SPRITE_WIDTH, y*SPRITE_HEIGHT);
+                        getScene().setFocus(penelope);
                         break;
                     case Level::wall:
                         cerr << "Location " << x << " " << y << " holds a Wall" << endl;
-                        actors.push_back(new Wall(this, x*LEVEL_WIDTH, y*LEVEL_HEIGHT));
+                        addActor(new Wall(this, x*SPRITE_WIDTH, y*SPRITE_HEIGHT));
+                        wallCells[y*gridWidth + x] = true;
                         break;
                     case Level::exit:
                         cerr << "Location " << x << " " << y << " holds an exit" << endl;
-                        actors.push_back(new Exit(this, x*LEVEL_WIDTH, y*LEVEL_HEIGHT));
+                        addActor(new Exit(this, x*SPRITE_WIDTH, y*SPRITE_HEIGHT));
                         break;
                     case Level::pit:
                         cerr << "Location " << x << " " << y << " holds a pit" << endl;
-                        actors.push_back(new Pit(this, x*LEVEL_WIDTH, y*LEVEL_HEIGHT));
+                        addActor(new Pit(this, x*SPRITE_WIDTH, y*SPRITE_HEIGHT));
                         break;
                     case Level::vaccine_goodie:
                         cerr << "Location " << x << " " << y << " holds a vaccine goodie" << endl;
-                        actors.push_back(new VaccineGoodie(this, x*LEVEL_WIDTH, y*LEVEL_HEIGHT));
+                        addActor(new VaccineGoodie(this, x*SPRITE_WIDTH, y*SPRITE_HEIGHT));
                         break;
                     case Level::gas_can_goodie:
                         cerr << "Location " << x << " " << y << " holds a gas can goodie" << endl;
-                        actors.push_back(new GasCanGoodie(this, x*LEVEL_WIDTH, y*LEVEL_HEIGHT));
+                        addActor(new GasCanGoodie(this, x*SPRITE_WIDTH, y*SPRITE_HEIGHT));
                         break;
                     case Level::landmine_goodie:
                         cerr << "Location " << x << " " << y << " holds a landmine goodie" << endl;
-                        actors.push_back(new LandmineGoodie(this, x*LEVEL_WIDTH, y*LEVEL_HEIGHT));
+                        addActor(new LandmineGoodie(this, x*SPRITE_WIDTH, y*SPRITE_HEIGHT));
                         break;
                     case Level::citizen:
                         cerr << "Location " << x << " " << y << " holds a citizen" << endl;
-                        actors.push_back(new Citizen(this, x*LEVEL_WIDTH, y*LEVEL_HEIGHT));
+                        addActor(new Citizen(this, x*SPRITE_WIDTH, y*SPRITE_HEIGHT));
                         numCitizens++;
                         break;
                     case Level::dumb_zombie:
                         cerr << "Location " << x << " " << y << " holds a dumb zombie" << endl;
-                        actors.push_back(new DumbZombie(this, x*LEVEL_WIDTH, y*LEVEL_HEIGHT));
+                        addActor(new DumbZombie(this, x*SPRITE_WIDTH, y*SPRITE_HEIGHT));
                         break;
                     case Level::smart_zombie:
                         cerr << "Location " << x << " " << y << " holds a smart zombie" << endl;
-                        actors.push_back(new SmartZombie(this, x*LEVEL_WIDTH, y*LEVEL_HEIGHT));
+                        addActor(new SmartZombie(this, x*SPRITE_WIDTH, y*SPRITE_HEIGHT));
                         break;
                     default:
                         cerr << "Location " << x << " " << y << " is another object" << endl;
@@ -109,21 +139,81 @@ int StudentWorld::init()
         }
     }
     
+    applyCommands();
+    if(resortPeriod > 0)
+        resortIfDue();
+    
     return GWSTATUS_CONTINUE_GAME;
 }
 
 // each tick of the game is a move call
 int StudentWorld::move()
 {
+    // every job from last tick was waited for
+    jobs.reset();
+    AllocationTracker::enterPhase("timers");
+    
+    // fire the timers due this tick: infections running their course,
+    // landmines arming, flames and vomit going away
+    timers.advance([](Actor* a)
+    {
+        if(a->isAlive())
+            a->timerExpired();
+    });
+    
+    if(!penelope->isAlive())
+    {
+        decLives();
+        return GWSTATUS_PLAYER_DIED;
+    }
+    
     // penelope gets to do something each tick
+    AllocationTracker::enterPhase("penelope");
     penelope->doSomething();
 
-    // all actors get a chance to do something
-    for(int i = 0; i < actors.size(); i++)
+    // actors due this tick get a chance to do something; paralyzed ones
+    // and ones that only react to timers and contacts are not visited
+    AllocationTracker::enterPhase("decide");
+    dueActors.clear();
+    scheduler.collectDue(getCurrentTick(), dueActors);
+    
+    // first every due actor plans against the world as it stands now.
+    // Planning changes nothing but the planner, so the world stays frozen
+    // until all plans are made and they can be made on any thread.
+    if(typedDispatch)
+    {
+        // one type at a time, calling that type's decide() directly
+        dueLists.clear();
+        for(int i = 0; i < dueActors.size(); i++)
+            dueLists.push(dueActors[i]);
+        
+        dueLists.forEachList([this](auto& list)
+        {
+            typedef typename remove_pointer<typename remove_reference<decltype(list)>::type::value_type>::type T;
+            jobs.parallelFor(static_cast<int>(list.size()), [&list](int i)
+            {
+                if(list[i]->isAlive())
+                    list[i]->T::decide();
+            });
+        });
+    }
+    else
     {
-        if (actors[i] != nullptr && actors[i]->isAlive())
+        jobs.parallelFor(static_cast<int>(dueActors.size()), [this](int i)
         {
-            actors[i]->doSomething();
+            if(dueActors[i]->isAlive())
+                dueActors[i]->decide();
+        });
+    }
+    
+    // then plans are carried out one at a time in schedule order, so a
+    // seeded run plays out the same however many threads planned it
+    AllocationTracker::enterPhase("commit");
+    for(int i = 0; i < dueActors.size(); i++)
+    {
+        if (dueActors[i]->isAlive())
+        {
+            dueActors[i]->commit();
             
             if(!penelope->isAlive())
             {
@@ -139,48 +229,69 @@ int StudentWorld::move()
         }
     }
     
-    // clean dead actors
-    for(vector<Actor*>::iterator p = actors.begin(); p != actors.end();)
-    {
-        if(!(*p)->isAlive())
-        {
-            delete *p;
-            p = actors.erase(p);
-        }
-        else
-            p++;
-    }
+    // activating objects act on whatever overlaps them while the agent
+    // grid is rebuilt alongside; contacts only kill, and spawns and
+    // removals wait for the end of the tick, so neither disturbs the other
+    AllocationTracker::enterPhase("contacts");
+    auto index = [this] { indexAgents(); };
+    JobSystem::JobId indexed = jobs.submit(index);
+    resolveContacts();
+    jobs.wait(indexed);
     
-    // stringstream to display game information
-    ostringstream oss;
+    // flames burn and vomit infects everything in their area
+    AllocationTracker::enterPhase("area effects");
+    applyAreaEffects();
     
-    int score = getScore();
-    int level = getLevel();
-    int lives = getLives();
-    int vaccines = penelope->getNumVaccines();
-    int flames = penelope->getNumFlameCharges();
-    int landmines = penelope->getNumLandmines();
-    int infectCount = penelope->getInfectionCount();
+    if(!penelope->isAlive())
+    {
+        decLives();
+        return GWSTATUS_PLAYER_DIED;
+    }
     
-    oss.fill('0');
-    oss << "Score: \t";
-    if(score < 0)
-        oss << "-" << setw(5) << -1*score;
-    else
-        oss << setw(6) << score;
-    oss << "\t \t Level: \t \t" << level;
-    oss << "\t \t Lives: \t" << lives;
-    oss << "\t \t Vaccines: \t" << vaccines;
-    oss << "\t \t Flames: \t" << flames;
-    oss << "\t \t Mines: \t" << landmines;
-    oss << "\t \t Infected: \t" << infectCount;
+    if(penelope->atExit())
+    {
+        playSound(SOUND_LEVEL_FINISHED);
+        return GWSTATUS_FINISHED_LEVEL;
+    }
     
-    string text = oss.str();
-    setGameStatText(text);
+    // clean dead actors, bring in the new ones and show the game information
+    AllocationTracker::enterPhase("end of tick");
+    applyCommands();
+    if(resortPeriod > 0)
+        resortIfDue();
+    updateStatus();
     
     return GWSTATUS_CONTINUE_GAME;
 }
 
+void StudentWorld::updateStatus()
+{
+    int values[NUM_STATUS_VALUES] = {
+        getScore(), getLevel(), getLives(), penelope->getNumVaccines(),
+        penelope->getNumFlameCharges(), penelope->getNumLandmines(), penelope->getInfectionCount()
+    };
+    if(statusShown && equal(values, values + NUM_STATUS_VALUES, shownStatus))
+        return;
+    
+    copy(values, values + NUM_STATUS_VALUES, shownStatus);
+    statusShown = true;
+    formatStatus(statusText, values);
+    setGameStatText(statusText);
+}
+
+// formats game information: score, level, lives, vaccines, flames, mines, infected
+void StudentWorld::formatStatus(string& text, const int values[])
+{
+    char line[256];
+    const char* scoreFormat = (values[0] < 0 ? "Score: \t-%05d" : "Score: \t%06d");
+    int length = snprintf(line, sizeof(line), scoreFormat, abs(values[0]));
+    length += snprintf(line + length, sizeof(line) - length,
+                       "\t \t Level: \t \t%d\t \t Lives: \t%d\t \t Vaccines: \t%d"
+                       "\t \t Flames: \t%d\t \t Mines: \t%d\t \t Infected: \t%d",
+                       values[1], values[2], values[3], values[4], values[5], values[6]);
+    text.assign(line, length);
+}
+
 // destroy all actors
 void StudentWorld::cleanUp()
 {
@@ -190,6 +301,23 @@ void StudentWorld::cleanUp()
         actors[i] = nullptr;
     }
     actors.clear();
+    positions.clear();
+    actorLists.clear();
+    
+    // actors spawned during a tick that ended early never joined
+    for(int i = 0; i < commands.size(); i++)
+    {
+        for(int j = 0; j < commands[i].spawns.size(); j++)
+            delete commands[i].spawns[j];
+        commands[i].spawns.clear();
+        commands[i].removals.clear();
+    }
+    
+    contactGrid.clear();
+    newActivators.clear();
+    scheduler.clear();
+    agentGrid.clear();
+    areaEffects.clear();
     
     delete penelope;
     penelope = nullptr;
@@ -206,31 +334,361 @@ int StudentWorld::getEuclidean(int x1, int y1, int x2, int y2) const
 
 int StudentWorld::getNumCitizens() const { return numCitizens; }
 
-void StudentWorld::addActor(Actor* a) { actors.push_back(a); }
+void StudentWorld::addActor(Actor* a)
+{
+    commands[JobSystem::threadIndex()].spawns.push_back(a);
+}
+
+void StudentWorld::removeActor(Actor* a)
+{
+    if(a == penelope)
+        return;
+    
+    // the dead stop turning up in searches now, not when reaped
+    if(a->getSlot() >= 0)
+        positions.setCategories(a->getSlot(), 0);
+    commands[JobSystem::threadIndex()].removals.push_back(a);
+}
+
+unsigned char StudentWorld::categoriesOf(const Actor* a)
+{
+    unsigned char categories = 0;
+    if(a->triggersZombieVomit())
+        categories |= VOMIT_TRIGGER;
+    if(a->threatensCitizens())
+        categories |= CITIZEN_THREAT;
+    return categories;
+}
+
+// removed actors swap the last actor into their slot and are marked by
+// losing it; the structures that keep actors in order then drop every
+// marked one in a single pass, so a tick's removals cost the same however
+// many there are. Buffers are applied in thread order; everything spawned
+// or removed outside of decide() goes through the first one, in the order
+// it happened.
+void StudentWorld::applyCommands()
+{
+    bool removedScheduled = false;
+    bool removedActivator = false;
+    for(int i = 0; i < commands.size(); i++)
+    {
+        vector<Actor*>& removals = commands[i].removals;
+        for(int j = 0; j < removals.size(); j++)
+        {
+            Actor* a = removals[j];
+            int slot = a->getSlot();
+            if(slot < 0)
+            {
+                // never placed: spawned this tick, so it only has to leave
+                // the spawns; or removed twice, and already gone
+                if(!takeSpawn(a))
+                    removals[j] = nullptr;
+                continue;
+            }
+            actors[slot] = actors.back();
+            actors[slot]->setSlot(slot);
+            actors.pop_back();
+            positions.removeBySwap(slot);
+            a->setSlot(-1);
+            
+            if(typedDispatch)
+                actorLists.remove(a);
+            if(a->getTickPeriod() > 0)
+                removedScheduled = true;
+            if(a->activatesOnContact())
+                removedActivator = true;
+        }
+    }
+    
+    auto gone = [](const Actor* a) { return a->getSlot() < 0; };
+    if(removedScheduled)
+        scheduler.removeIf(gone);
+    if(removedActivator)
+        newActivators.erase(remove_if(newActivators.begin(), newActivators.end(), gone),
+                            newActivators.end());
+    for(int i = 0; i < commands.size(); i++)
+    {
+        vector<Actor*>& removals = commands[i].removals;
+        for(int j = 0; j < removals.size(); j++)
+        {
+            if(removals[j] != nullptr && removals[j]->activatesOnContact())
+                contactGrid.removeIf(removals[j]->getX(), removals[j]->getY(), gone);
+        }
+    }
+    for(int i = 0; i < commands.size(); i++)
+    {
+        vector<Actor*>& removals = commands[i].removals;
+        for(int j = 0; j < removals.size(); j++)
+            delete removals[j];
+        removals.clear();
+    }
+    
+    for(int i = 0; i < commands.size(); i++)
+    {
+        vector<Actor*>& spawns = commands[i].spawns;
+        actors.reserve(actors.size() + spawns.size());
+        for(int j = 0; j < spawns.size(); j++)
+        {
+            Actor* a = spawns[j];
+            a->setSlot(positions.push(a->getX(), a->getY(), categoriesOf(a)));
+            actors.push_back(a);
+            if(typedDispatch)
+                actorLists.insert(a);
+            
+            int period = a->getTickPeriod();
+            if(period > 0)
+                scheduler.add(a, period, getCurrentTick() + period);
+            
+            if(a->activatesOnContact())
+                newActivators.push_back(a);
+        }
+        spawns.clear();
+    }
+}
+
+bool StudentWorld::takeSpawn(Actor* a)
+{
+    for(int i = 0; i < commands.size(); i++)
+    {
+        vector<Actor*>& spawns = commands[i].spawns;
+        vector<Actor*>::iterator p = find(spawns.begin(), spawns.end(), a);
+        if(p != spawns.end())
+        {
+            spawns.erase(p);
+            return true;
+        }
+    }
+    return false;
+}
+
+// slot order decides who goes first in contacts and who wins ties in the
+// searches, so the sort breaks ties by slot and is the same on every run
+void StudentWorld::resortIfDue()
+{
+    int n = static_cast<int>(actors.size());
+    resortKeys.resize(n);
+    int disorder = 0;
+    for(int i = 0; i < n; i++)
+    {
+        resortKeys[i] = make_pair(mortonKeyAt(actors[i]->getX(), actors[i]->getY()), i);
+        if(i > 0 && resortKeys[i].first < resortKeys[i-1].first)
+            disorder++;
+    }
+    
+    bool due = (getCurrentTick() - lastResort >= resortPeriod || getCurrentTick() == 0);
+    if(!due && disorder * RESORT_DISORDER <= n)
+        return;
+    lastResort = getCurrentTick();
+    if(disorder == 0)
+        return;
+    
+    sort(resortKeys.begin(), resortKeys.end());
+    resortFrom.resize(n);
+    for(int i = 0; i < n; i++)
+        resortFrom[i] = resortKeys[i].second;
+    
+    positions.reorder(resortFrom);
+    resortActors.resize(n);
+    for(int i = 0; i < n; i++)
+    {
+        resortActors[i] = actors[resortFrom[i]];
+        resortActors[i]->setSlot(i);
+    }
+    actors.swap(resortActors);
+}
+
+// interleaves the bits of the cell's column and row
+unsigned StudentWorld::mortonKeyAt(Coord x, Coord y) const
+{
+    int cell = cellIndexAt(x, y);
+    unsigned key = 0;
+    unsigned cellX = cell % gridWidth;
+    unsigned cellY = cell / gridWidth;
+    for(int bit = 0; bit < 16; bit++)
+    {
+        key |= (cellX >> bit & 1u) << (2*bit);
+        key |= (cellY >> bit & 1u) << (2*bit + 1);
+    }
+    return key;
+}
+
+void StudentWorld::actorMoved(Actor* a)
+{
+    positions.set(a->getSlot(), a->getX(), a->getY());
+}
 
 void StudentWorld::recordCitizenGone() { numCitizens--; }
 
-// checks overlap of ActivatingObjects on each actor in the StudentWorld
-void StudentWorld::activateOnAppropriateActors(Actor* a)
+// splitmix64 of the world seed, level and count of agents seeded so far
+unsigned long long StudentWorld::nextAgentSeed()
 {
-    if(getEuclidean(a->getX(), a->getY(), penelope->getX(), penelope->getY()) <= 100)
+    unsigned long long z = (static_cast<unsigned long long>(getRandomSeed()) << 32) + getLevel();
+    z += ++agentSeedCount * 0x9E3779B97F4A7C15ULL;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+// spawns the visible flames and one burning area covering all of them;
+// flames burn for three ticks, starting with this one
+void StudentWorld::addFlames(const Coord xs[], const Coord ys[], int count, Direction dir)
+{
+    AreaEffect e;
+    e.apply = &Actor::dieByFallOrBurnIfAppropriate;
+    e.count = 0;
+    e.ticksLeft = 3;
+    
+    for(int i = 0; i < count && i < MAX_AREA_POINTS; i++)
+    {
+        addActor(new Flame(this, xs[i], ys[i], dir));
+        e.x[e.count] = xs[i];
+        e.y[e.count] = ys[i];
+        e.count++;
+    }
+    
+    if(e.count > 0)
+        areaEffects.push_back(e);
+}
+
+// spawns vomit and the area it infects for three ticks, starting with this one
+void StudentWorld::addVomit(Coord x, Coord y, Direction dir)
+{
+    addActor(new Vomit(this, x, y, dir));
+    
+    AreaEffect e;
+    e.apply = &Actor::beVomitedOnIfAppropriate;
+    e.x[0] = x;
+    e.y[0] = y;
+    e.count = 1;
+    e.ticksLeft = 3;
+    areaEffects.push_back(e);
+}
+
+long long StudentWorld::getCurrentTick() const { return timers.getNow(); }
+
+void StudentWorld::scheduleTimer(TimerWheel::Timer& t, Actor* owner, long long due)
+{
+    timers.schedule(t, owner, due);
+}
+
+void StudentWorld::cancelTimer(TimerWheel::Timer& t) { timers.cancel(t); }
+
+// places new activators in the contact grid, then lets every activator
+// act on the agents overlapping it. Agents look up the activators around
+// them, so activators nobody is near cost nothing.
+void StudentWorld::resolveContacts()
+{
+    // new activators act on placed ones they landed on (e.g. a pit opened
+    // by an explosion swallowing a goodie) and vice versa; activators
+    // created while doing so join at the end of the tick
+    for(size_t i = 0; i < newActivators.size(); i++)
     {
-        if(penelope->isAlive())
-            a->activateIfAppropriate(penelope);
+        Actor* a = newActivators[i];
+        if(!a->isAlive())
+            continue;
+        
+        contactGrid.forEachNear(a->getX(), a->getY(), [&](Actor* other)
+        {
+            if(!other->isAlive() || !a->isAlive() ||
+               getEuclidean(a->getX(), a->getY(), other->getX(), other->getY()) > 100)
+                return;
+            a->activateIfAppropriate(other);
+            if(other->isAlive() && a->isAlive())
+                other->activateIfAppropriate(a);
+        });
+        
+        if(a->isAlive())
+            contactGrid.insert(a);
     }
+    newActivators.clear();
+    
+    activateContactsOn(penelope);
     
     for(int i = 0; i < actors.size(); i++)
     {
-        if(getEuclidean(a->getX(), a->getY(), actors[i]->getX(), actors[i]->getY()) <= 100)
+        if(actors[i]->isAlive() && actors[i]->triggersContacts())
+            activateContactsOn(actors[i]);
+    }
+}
+
+// runs beside resolveContacts, so it reads nothing a contact can change:
+// dead agents are left in and skipped by whoever queries the grid
+void StudentWorld::indexAgents()
+{
+    agentGrid.clear();
+    agentGrid.insert(penelope);
+    for(int i = 0; i < actors.size(); i++)
+    {
+        if(actors[i]->triggersContacts())
+            agentGrid.insert(actors[i]);
+    }
+}
+
+// applies every area effect for this tick. Effects started while doing
+// so (a burning landmine setting off its neighbours) apply this tick too.
+void StudentWorld::applyAreaEffects()
+{
+    for(size_t i = 0; i < areaEffects.size(); i++)
+    {
+        AreaEffect e = areaEffects[i];     // copy; applying may add effects
+        applyAreaEffect(e);
+        areaEffects[i].ticksLeft--;
+    }
+    
+    vector<AreaEffect>::iterator p = areaEffects.begin();
+    for(vector<AreaEffect>::iterator q = areaEffects.begin(); q != areaEffects.end(); q++)
+    {
+        if(q->ticksLeft > 0)
+            *p++ = *q;
+    }
+    areaEffects.erase(p, areaEffects.end());
+}
+
+// one region query over the bounding box of the effect's points finds
+// the agents and activators that might overlap it
+void StudentWorld::applyAreaEffect(const AreaEffect& e)
+{
+    Coord minX = e.x[0], maxX = e.x[0];
+    Coord minY = e.y[0], maxY = e.y[0];
+    for(int i = 1; i < e.count; i++)
+    {
+        minX = min(minX, e.x[i]);
+        maxX = max(maxX, e.x[i]);
+        minY = min(minY, e.y[i]);
+        maxY = max(maxY, e.y[i]);
+    }
+    
+    auto applyIfInside = [&](Actor* a)
+    {
+        if(!a->isAlive())
+            return;
+        for(int i = 0; i < e.count; i++)
         {
-            if(actors[i]->isAlive())
-                a->activateIfAppropriate(actors[i]);
+            if(getEuclidean(e.x[i], e.y[i], a->getX(), a->getY()) <= 100)
+            {
+                (a->*e.apply)();
+                return;
+            }
         }
-    }
+    };
+    
+    agentGrid.forEachInRect(minX-10, minY-10, maxX+10, maxY+10, applyIfInside);
+    contactGrid.forEachInRect(minX-10, minY-10, maxX+10, maxY+10, applyIfInside);
+}
+
+// activates every live activator whose position is within range of a
+void StudentWorld::activateContactsOn(Actor* a)
+{
+    contactGrid.forEachNear(a->getX(), a->getY(), [&](Actor* activator)
+    {
+        if(activator->isAlive() && a->isAlive() &&
+           getEuclidean(activator->getX(), activator->getY(), a->getX(), a->getY()) <= 100)
+            activator->activateIfAppropriate(a);
+    });
 }
 
 // checks if agent movement blocked by other actors in StudentWorld
-bool StudentWorld::isAgentMovementBlockedAt(double x, double y, Actor* itself) const
+bool StudentWorld::isAgentMovementBlockedAt(Coord x, Coord y, Actor* itself) const
 {
     int otherX, otherY;
     
@@ -243,19 +701,13 @@ bool StudentWorld::isAgentMovementBlockedAt(double x, double y, Actor* itself) c
             return true;
     }
     
-    for(int i = 0; i < actors.size(); i++)
+    // the packed positions find the actors overlapping (x,y) a batch at a
+    // time; only those are asked whether they block
+    return positions.anyOverlapping(x, y, [&](int slot)
     {
-        if(actors[i]->isAlive() && actors[i]->canBlockMovement() && actors[i] != itself)
-        {
-            otherX = actors[i]->getX();
-            otherY = actors[i]->getY();
-            
-            if(checkBoundaries(x, y, otherX, otherY))
-                return true;
-        }
-    }
-    
-    return false;
+        Actor* a = actors[slot];
+        return a->isAlive() && a->canBlockMovement() && a != itself;
+    });
 }
 
 // checks if (x,y) lies within another object's image based on
@@ -281,8 +733,16 @@ bool StudentWorld::checkBoundaries(int x, int y, int otherX, int otherY) const
 }
 
 // Checks if flames are blocked by other actors at (x,y)
-bool StudentWorld::isFlameBlockedAt(double x, double y) const
+bool StudentWorld::isFlameBlockedAt(Coord x, Coord y) const
 {
+    if(typedDispatch)
+    {
+        return actorLists.anyOf<BlocksFlame>([&](Actor* a)
+        {
+            return a->isAlive() && getEuclidean(x, y, a->getX(), a->getY()) <= 100;
+        });
+    }
+    
     for(int i = 0; i < actors.size(); i++)
     {
         if(actors[i]->isAlive() && actors[i]->canBlockFlame() && getEuclidean(x, y, actors[i]->getX(), actors[i]->getY()) <= 100)
@@ -293,11 +753,19 @@ bool StudentWorld::isFlameBlockedAt(double x, double y) const
 }
 
 // checks if there is a Person that a zombie can vomit on at (x,y)
-bool StudentWorld::isZombieVomitTriggerAt(double x, double y) const
+bool StudentWorld::isZombieVomitTriggerAt(Coord x, Coord y) const
 {
     if(penelope->isAlive() && getEuclidean(x, y, penelope->getX(), penelope->getY()) <= 100)
         return true;
     
+    if(typedDispatch)
+    {
+        return actorLists.anyOf<TriggersZombieVomit>([&](Actor* a)
+        {
+            return a->isAlive() && getEuclidean(x, y, a->getX(), a->getY()) <= 100;
+        });
+    }
+    
     for(int i = 0; i < actors.size(); i++)
     {
         if(actors[i]->isAlive() && actors[i]->triggersZombieVomit() && getEuclidean(x, y, actors[i]->getX(), actors[i]->getY()) <= 100)
@@ -307,15 +775,16 @@ bool StudentWorld::isZombieVomitTriggerAt(double x, double y) const
 }
 
 // checks if there is a Person within smart zombie's range to follow
-// if it is within range, set closest Person coordinates to otherX, otherY
+// that the zombie can see past the walls; if it is within range, set closest Person coordinates to otherX, otherY
 // and store Euclidean distance between actors in distance
-bool StudentWorld::locateNearestVomitTrigger(double x, double y, double& otherX, double& otherY, double& distance)
+bool StudentWorld::locateNearestVomitTrigger(Coord x, Coord y, Coord& otherX, Coord& otherY, int& distance) const
 {
     bool found = false;
     
     distance = 6400;
     
-    if(penelope->isAlive() && getEuclidean(x, y, penelope->getX(), penelope->getY()) <= distance)
+    if(penelope->isAlive() && getEuclidean(x, y, penelope->getX(), penelope->getY()) <= distance &&
+       hasLineOfSight(x, y, penelope->getX(), penelope->getY()))
     {
         distance = getEuclidean(x, y, penelope->getX(), penelope->getY());
         otherX = penelope->getX();
@@ -323,16 +792,21 @@ bool StudentWorld::locateNearestVomitTrigger(double x, double y, double& otherX,
         found = true;
     }
     
-    for(int i = 0; i < actors.size(); i++)
+    // the kernel picks out the people within range; they are then tried
+    // in actor order, nearer or equally near ones replacing the best so
+    // far, as long as the zombie can see them
+    positions.forEachWithin(x, y, VOMIT_TRIGGER, distance, [&](int slot)
     {
-        if(actors[i]->isAlive() && actors[i]->triggersZombieVomit() && getEuclidean(x, y, actors[i]->getX(), actors[i]->getY()) <= distance)
+        Actor* a = actors[slot];
+        int d = getEuclidean(x, y, a->getX(), a->getY());
+        if(d <= distance && hasLineOfSight(x, y, a->getX(), a->getY()))
         {
-            distance = getEuclidean(x, y, actors[i]->getX(), actors[i]->getY());
-            otherX = actors[i]->getX();
-            otherY = actors[i]->getY();
+            distance = d;
+            otherX = a->getX();
+            otherY = a->getY();
             found = true;
         }
-    }
+    });
     return found;
 }
 
@@ -342,7 +816,7 @@ bool StudentWorld::locateNearestVomitTrigger(double x, double y, double& otherX,
 // Euclidean distance between actors to distance. If the closest
 // actor is a zombie, isThreat is set to false. If closest is
 // penelope, isThreat is set to true
-bool StudentWorld::locateNearestCitizenTrigger(double x, double y, double& otherX, double& otherY, double& distance, bool& isThreat) const
+bool StudentWorld::locateNearestCitizenTrigger(Coord x, Coord y, Coord& otherX, Coord& otherY, int& distance, bool& isThreat) const
 {
     bool found = false;
     
@@ -355,9 +829,9 @@ bool StudentWorld::locateNearestCitizenTrigger(double x, double y, double& other
         found = true;
     }
     
-    double zombieX = otherX;
-    double zombieY = otherY;
-    double zombiedist = distance;
+    Coord zombieX = otherX;
+    Coord zombieY = otherY;
+    int zombiedist = distance;
     
     if(locateNearestCitizenThreat(x, y, zombieX, zombieY, zombiedist))
     {
@@ -377,29 +851,24 @@ bool StudentWorld::locateNearestCitizenTrigger(double x, double y, double& other
 // checks if there is a zombie within citizen's range to run from
 // if there is, stores closest zombie coordinates in otherX, otherY, and
 // stores Euclidean distance between actors in distance
-bool StudentWorld::locateNearestCitizenThreat(double x, double y, double& otherX, double& otherY, double& distance) const
+bool StudentWorld::locateNearestCitizenThreat(Coord x, Coord y, Coord& otherX, Coord& otherY, int& distance) const
 {
     bool found = false;
     
-    for(int i = 0; i < actors.size(); i++)
+    // nearest live zombie closer than distance, earliest actor on ties
+    int slot = positions.nearest(x, y, CITIZEN_THREAT, distance);
+    if(slot >= 0)
     {
-        if(actors[i]->isAlive() && actors[i]->threatensCitizens())
-        {
-            if(getEuclidean(x, y, actors[i]->getX(), actors[i]->getY()) < distance)
-            {
-                otherX = actors[i]->getX();
-                otherY = actors[i]->getY();
-                distance = getEuclidean(x, y, actors[i]->getX(), actors[i]->getY());
-                found = true;
-            }
-        }
+        otherX = actors[slot]->getX();
+        otherY = actors[slot]->getY();
+        found = true;
     }
     
     return found;
 }
 
 // checks if any overlap occurs with any actor in the StudentWorld
-bool StudentWorld::isThrownGoodieBlockedAt(double x, double y) const
+bool StudentWorld::isThrownGoodieBlockedAt(Coord x, Coord y) const
 {
     int otherX, otherY;
     
@@ -412,17 +881,91 @@ bool StudentWorld::isThrownGoodieBlockedAt(double x, double y) const
             return true;
     }
     
-    for(int i = 0; i < actors.size(); i++)
+    return positions.anyOverlapping(x, y, [&](int slot)
     {
-        if(actors[i]->isAlive())
+        return actors[slot]->isAlive();
+    });
+}
+
+// checks whether walls block sight between the cells of (x1,y1) and (x2,y2),
+// remembering the answer for each pair of cells
+bool StudentWorld::hasLineOfSight(Coord x1, Coord y1, Coord x2, Coord y2) const
+{
+    int from = cellIndexAt(x1, y1);
+    int to = cellIndexAt(x2, y2);
+    
+    if(from == to)
+        return true;
+    if(from > to)               // sight is symmetric, so share one entry
+        swap(from, to);
+    
+    unsigned long long key = static_cast<unsigned long long>(from) * gridWidth * gridHeight + to;
+    atomic<unsigned long long>& slot = sightCache[(key * 0x9E3779B97F4A7C15ULL) >> (64 - SIGHT_CACHE_BITS)];
+    
+    // entries hold (key, result) packed as 2*key+result+1; zero is empty
+    unsigned long long entry = slot.load(memory_order_relaxed);
+    if(entry != 0 && (entry - 1) >> 1 == key)
+        return ((entry - 1) & 1) != 0;
+    
+    bool visible = traceSight(from, to);
+    slot.store((key << 1 | (visible ? 1 : 0)) + 1, memory_order_relaxed);
+    return visible;
+}
+
+// finds the cell holding the center of the sprite whose corner is at (x,y)
+int StudentWorld::cellIndexAt(Coord x, Coord y) const
+{
+    int cellX = (static_cast<int>(x) + SPRITE_WIDTH/2) / SPRITE_WIDTH;
+    int cellY = (static_cast<int>(y) + SPRITE_HEIGHT/2) / SPRITE_HEIGHT;
+    cellX = max(0, min(gridWidth-1, cellX));
+    cellY = max(0, min(gridHeight-1, cellY));
+    return cellY * gridWidth + cellX;
+}
+
+// grid DDA over every cell the segment between the two cell centers
+// touches; a segment passing exactly through a corner is blocked if
+// either of the cells beside that corner is a wall
+bool StudentWorld::traceSight(int fromCell, int toCell) const
+{
+    int x = fromCell % gridWidth;
+    int y = fromCell / gridWidth;
+    int endX = toCell % gridWidth;
+    int endY = toCell / gridWidth;
+    
+    int nx = abs(endX - x);
+    int ny = abs(endY - y);
+    int stepX = (endX > x ? 1 : -1);
+    int stepY = (endY > y ? 1 : -1);
+    
+    for(int ix = 0, iy = 0; ix < nx || iy < ny;)
+    {
+        // compares where the segment next crosses a vertical edge
+        // against where it next crosses a horizontal edge
+        int decision = (1 + 2*ix) * ny - (1 + 2*iy) * nx;
+        
+        if(decision == 0)
         {
-            otherX = actors[i]->getX();
-            otherY = actors[i]->getY();
-            
-            if(checkBoundaries(x, y, otherX, otherY))
-                return true;
+            if(wallCells[y*gridWidth + x+stepX] || wallCells[(y+stepY)*gridWidth + x])
+                return false;
+            x += stepX;
+            y += stepY;
+            ix++;
+            iy++;
+        }
+        else if(decision < 0)
+        {
+            x += stepX;
+            ix++;
+        }
+        else
+        {
+            y += stepY;
+            iy++;
         }
+        
+        if(wallCells[y*gridWidth + x])
+            return false;
     }
     
-    return false;
+    return true;
 }
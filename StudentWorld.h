@@ -2,8 +2,14 @@
 #define STUDENTWORLD_H_
 
 #include "GameWorld.h"
+#include "ActorGrid.h"
+#include "PhaseScheduler.h"
+#include "JobSystem.h"
+#include "ActorTypes.h"
+#include "PackedPositions.h"
 #include <string>
 #include <vector>
+#include <atomic>
 
 class Actor;
 class Penelope;
@@ -26,44 +32,78 @@ public:
     // Returns number of citizens in StudentWorld
     int getNumCitizens() const;
     
-    // Add an actor to the world.
+    // Add an actor to the world. Actors added during a tick join the world
+    // together at the end of it; each first acts a full tick period after
+    // that, and activators that act on contact join the contact grid at
+    // the next contact pass.
     void addActor(Actor* a);
     
+    // Take a, which has just died, out of the world at the end of the tick
+    void removeActor(Actor* a);
+    
+    // Record that a, which is in the world, has moved
+    void actorMoved(Actor* a);
+    
+    // Add flames facing dir at the count locations given by xs and ys.
+    // Together they form one burning area: while the flames last, a single
+    // region query per tick burns everything overlapping any of them.
+    void addFlames(const Coord xs[], const Coord ys[], int count, Direction dir);
+    
+    // Add vomit facing dir at (x,y). While it lasts, StudentWorld vomits
+    // on everything overlapping it each tick.
+    void addVomit(Coord x, Coord y, Direction dir);
+    
+    // Returns the number of the tick being played, counted from init()
+    long long getCurrentTick() const;
+    
+    // Schedule t to call owner's timerExpired() at the start of tick due,
+    // replacing any time t was already set for.
+    void scheduleTimer(TimerWheel::Timer& t, Actor* owner, long long due);
+    
+    // Stop t from firing
+    void cancelTimer(TimerWheel::Timer& t);
+    
+    // Returns the seed for a new agent's private random stream. Seeds
+    // follow from the world's random seed, the level and creation order.
+    unsigned long long nextAgentSeed();
+    
     // Record that one more citizen on the current level is gone (exited,
     // died, or turned into a zombie).
     void recordCitizenGone();
     
-    // For each actor overlapping a, activate a if appropriate.
-    void activateOnAppropriateActors(Actor* a);
-    
     // Is an agent blocked from moving to the indicated location?
-    bool isAgentMovementBlockedAt(double x, double y, Actor* itself) const;
+    bool isAgentMovementBlockedAt(Coord x, Coord y, Actor* itself) const;
     
     // Is creation of a flame blocked at the indicated location?
-    bool isFlameBlockedAt(double x, double y) const;
+    bool isFlameBlockedAt(Coord x, Coord y) const;
     
     // Is there something at the indicated location that might cause a
     // zombie to vomit (i.e., a human)?
-    bool isZombieVomitTriggerAt(double x, double y) const;
+    bool isZombieVomitTriggerAt(Coord x, Coord y) const;
     
-    // Return true if there is a living human, otherwise false.  If true,
-    // otherX, otherY, and distance will be set to the location and distance
-    // of the human nearest to (x,y).
-    bool locateNearestVomitTrigger(double x, double y, double& otherX, double& otherY, double& distance);
+    // Return true if there is a living human in sight, otherwise false.  If
+    // true, otherX, otherY, and distance will be set to the location and
+    // distance of the visible human nearest to (x,y).
+    bool locateNearestVomitTrigger(Coord x, Coord y, Coord& otherX, Coord& otherY, int& distance) const;
     
     // Return true if there is a living zombie or Penelope, otherwise false.
     // If true, otherX, otherY, and distance will be set to the location and
     // distance of the one nearest to (x,y), and isThreat will be set to true
     // if it's a zombie, false if a Penelope.
-    bool locateNearestCitizenTrigger(double x, double y, double& otherX, double& otherY, double& distance, bool& isThreat) const;
+    bool locateNearestCitizenTrigger(Coord x, Coord y, Coord& otherX, Coord& otherY, int& distance, bool& isThreat) const;
     
     // Return true if there is a living zombie, false otherwise.  If true,
     // otherX, otherY and distance will be set to the location and distance
     // of the one nearest to (x,y).
-    bool locateNearestCitizenThreat(double x, double y, double& otherX, double& otherY, double& distance) const;
+    bool locateNearestCitizenThreat(Coord x, Coord y, Coord& otherX, Coord& otherY, int& distance) const;
     
     // Does DumbZombie's thrown vaccine overlap with any other actor at (x,y)?
-    bool isThrownGoodieBlockedAt(double x, double y) const;
+    bool isThrownGoodieBlockedAt(Coord x, Coord y) const;
+    
+    // Can an actor at (x1,y1) see an actor at (x2,y2)? Sight is traced
+    // between the centers of the cells the two sprites occupy and is
+    // blocked only by walls.
+    bool hasLineOfSight(Coord x1, Coord y1, Coord x2, Coord y2) const;
 
 private:
     // Does euclidean calculation
@@ -73,9 +113,126 @@ private:
     // otherX+SPRITE_WIDTH, and otherY+SPRITE_HEIGHT
     bool checkBoundaries(int x, int y, int otherX, int otherY) const;   // boundary check
     
+    // Returns index of the cell holding the center of a sprite at (x,y)
+    int cellIndexAt(Coord x, Coord y) const;
+    
+    // Has each activator act on the agents overlapping it; run once per
+    // tick after all actors have moved
+    void resolveContacts();
+    
+    // Has every live activator overlapping a act on a
+    void activateContactsOn(Actor* a);
+    
+    // Rebuilds the agent grid from where agents stand now. Agents that
+    // died this tick stay in until they are reaped.
+    void indexAgents();
+    
+    // Hands on the game information line shown above the play field,
+    // formatting it again only if a value in it changed since last time
+    void updateStatus();
+    
+    // Writes the game information line into text, reusing its storage
+    static void formatStatus(std::string& text, const int values[]);
+    
+    // An effect applied each tick to every actor overlapping any of a set
+    // of points, e.g. the flames of one landmine explosion or one vomit
+    static const int MAX_AREA_POINTS = 9;
+    struct AreaEffect
+    {
+        void (Actor::*apply)();         // what happens to actors inside
+        Coord x[MAX_AREA_POINTS];
+        Coord y[MAX_AREA_POINTS];
+        int count;                      // number of points
+        int ticksLeft;                  // ticks the effect still applies
+    };
+    
+    // Category bits kept with each packed position, for the searches
+    // that only care about one kind of actor; dead actors have none
+    static const unsigned char VOMIT_TRIGGER = 1;
+    static const unsigned char CITIZEN_THREAT = 2;
+    
+    // Returns the category bits of a live actor
+    static unsigned char categoriesOf(const Actor* a);
+    
+    // Spawns and removals asked for during a tick, one buffer per thread
+    // so threads never share one
+    struct CommandBuffer
+    {
+        std::vector<Actor*> spawns;
+        std::vector<Actor*> removals;
+    };
+    
+    // Takes the actors removed this tick out of the world and deletes
+    // them, then brings in the actors spawned this tick
+    void applyCommands();
+    
+    // Takes a out of the spawns waiting in the command buffers, returning
+    // false if it isn't among them
+    bool takeSpawn(Actor* a);
+    
+    // Sorts actors into Z-order by the cells they stand in, so actors near
+    // each other on the map sit near each other in memory. Runs every
+    // resortPeriod ticks, or sooner once more than one in RESORT_DISORDER
+    // neighbouring slots are out of order. Ties keep their current order,
+    // so a seeded run sorts the same way every time.
+    void resortIfDue();
+    static const int RESORT_DISORDER = 4;
+    
+    // Returns the Z-order (Morton) key of the cell holding a sprite at (x,y)
+    unsigned mortonKeyAt(Coord x, Coord y) const;
+    
+    // Applies each area effect once and retires the expired ones
+    void applyAreaEffects();
+    
+    // Applies e to every actor overlapping one of its points
+    void applyAreaEffect(const AreaEffect& e);
+    
+    // Walks the cells crossed by the segment between two cell centers,
+    // returning false if any of them holds a wall
+    bool traceSight(int fromCell, int toCell) const;
+    
     Penelope* penelope;             // penelope
     std::vector<Actor*> actors;     // stores actors
+    PackedPositions positions;      // actors' positions, by the same slots
     int numCitizens;                // number of citizens remaining
+    
+    int gridWidth;                  // level width in cells
+    int gridHeight;                 // level height in cells
+    std::vector<bool> wallCells;    // static wall layout, one flag per cell
+    
+    ActorGrid contactGrid;              // placed contact activators by cell
+    std::vector<Actor*> newActivators;  // activators added since last contact pass
+    ActorGrid agentGrid;                // live agents by cell, rebuilt each tick
+    std::vector<AreaEffect> areaEffects;
+    TimerWheel timers;                  // per-actor countdowns
+    PhaseScheduler scheduler;           // actors that act every N ticks
+    std::vector<Actor*> dueActors;      // scratch: actors acting this tick
+    std::vector<CommandBuffer> commands;    // indexed by worker thread
+    
+    JobSystem jobs;                     // threads a tick's independent work runs on
+    
+    bool typedDispatch;                 // also keep and use actorLists
+    ActorLists actorLists;              // actors by concrete type
+    ActorLists dueLists;                // scratch: dueActors by concrete type
+    int resortPeriod;                   // ticks between Z-order sorts, 0 for never
+    long long lastResort;               // tick of the last Z-order sort
+    std::vector<std::pair<unsigned, int>> resortKeys;   // scratch: (key, slot) per actor
+    std::vector<int> resortFrom;        // scratch: old slot of each new slot
+    std::vector<Actor*> resortActors;   // scratch: actors in their new slots
+    unsigned long long agentSeedCount;  // agents seeded since init()
+    
+    // score, level, lives, vaccines, flames, mines and infection count
+    // as last shown in the game information line
+    static const int NUM_STATUS_VALUES = 7;
+    int shownStatus[NUM_STATUS_VALUES];
+    bool statusShown;                   // false until a line is shown after init()
+    std::string statusText;             // the line last shown
+    
+    // direct-mapped cache of traced sight lines; walls never change during
+    // a level, so entries stay valid from tick to tick until init().
+    // Entries are atomic because agents decide on several threads at once.
+    static const int SIGHT_CACHE_BITS = 12;
+    mutable std::vector<std::atomic<unsigned long long>> sightCache;
 };
 
 #endif // STUDENTWORLD_H_
@@ -0,0 +1,175 @@
+#ifndef TIMERWHEEL_H_
+#define TIMERWHEEL_H_
+
+class Actor;
+
+// Hierarchical timer wheel keyed by tick number. Level 0 holds timers due
+// within the next 64 ticks, one slot per tick; each higher level covers 64
+// times the span of the one below and is cascaded down as time reaches it.
+// Scheduling, cancelling and firing a timer are all O(1), and ticks with
+// nothing due only look at one empty slot.
+class TimerWheel
+{
+public:
+    // A timer lives inside the actor that owns it and unlinks itself when
+    // destroyed, so a dead actor can never be fired.
+    class Timer
+    {
+    public:
+        Timer()
+        : prev(nullptr), next(nullptr), due(0), owner(nullptr)
+        {}
+
+        ~Timer()
+        {
+            unlink();
+        }
+
+        bool isScheduled() const { return next != nullptr; }
+
+        long long getDue() const { return due; }
+
+        Timer(const Timer&) = delete;
+        Timer& operator=(const Timer&) = delete;
+
+    private:
+        friend class TimerWheel;
+
+        void unlink()
+        {
+            if(next != nullptr)
+            {
+                prev->next = next;
+                next->prev = prev;
+                prev = next = nullptr;
+            }
+        }
+
+        Timer* prev;
+        Timer* next;
+        long long due;
+        Actor* owner;
+    };
+
+    TimerWheel()
+    : now(0)
+    {
+        for(int level = 0; level < LEVELS; level++)
+            for(int slot = 0; slot < SLOTS; slot++)
+                emptySlot(slots[level][slot]);
+    }
+
+    // Drops every pending timer and restarts the clock at tick t
+    void reset(long long t)
+    {
+        for(int level = 0; level < LEVELS; level++)
+        {
+            for(int slot = 0; slot < SLOTS; slot++)
+            {
+                Timer& head = slots[level][slot];
+                while(head.next != &head)
+                    head.next->unlink();
+            }
+        }
+        now = t;
+    }
+
+    // Schedules (or reschedules) t to fire for owner at tick due; timers
+    // due at or before the current tick fire on the next advance
+    void schedule(Timer& t, Actor* owner, long long due)
+    {
+        t.unlink();
+        t.owner = owner;
+        t.due = (due > now ? due : now + 1);
+        insert(t);
+    }
+
+    void cancel(Timer& t)
+    {
+        t.unlink();
+    }
+
+    // Moves the clock forward one tick and calls fire(owner) for every
+    // timer due then. fire may schedule or cancel timers freely.
+    template<typename Func>
+    void advance(Func fire)
+    {
+        now++;
+
+        // bring the timers of the slot we just reached down a level
+        for(int level = LEVELS-1; level > 0; level--)
+        {
+            if((now & ((1LL << (BITS*level)) - 1)) == 0)
+                cascade(slots[level][(now >> (BITS*level)) & (SLOTS-1)]);
+        }
+
+        Timer& head = slots[0][now & (SLOTS-1)];
+        while(head.next != &head)
+        {
+            Timer* t = head.next;
+            t->unlink();
+            if(t->due <= now)
+                fire(t->owner);
+            else
+                insert(*t);     // not yet due; file it again
+        }
+    }
+
+    long long getNow() const { return now; }
+
+private:
+    static const int BITS = 6;
+    static const int SLOTS = 1 << BITS;
+    static const int LEVELS = 3;
+
+    static void emptySlot(Timer& head)
+    {
+        head.prev = head.next = &head;
+    }
+
+    void insert(Timer& t)
+    {
+        long long delta = t.due - now;
+        int level = 0;
+        while(level < LEVELS-1 && delta >= (1LL << (BITS*(level+1))))
+            level++;
+
+        // timers beyond the top level's span wait in its furthest slot
+        long long key = t.due;
+        if(delta >= (1LL << (BITS*LEVELS)))
+            key = now + (1LL << (BITS*LEVELS)) - 1;
+
+        Timer& head = slots[level][(key >> (BITS*level)) & (SLOTS-1)];
+        t.prev = head.prev;
+        t.next = &head;
+        head.prev->next = &t;
+        head.prev = &t;
+    }
+
+    void cascade(Timer& head)
+    {
+        Timer pending;
+        if(head.next == &head)
+            return;
+
+        // move the whole slot to a local list, then re-insert each timer
+        emptySlot(pending);
+        pending.next = head.next;
+        pending.prev = head.prev;
+        pending.next->prev = &pending;
+        pending.prev->next = &pending;
+        emptySlot(head);
+
+        while(pending.next != &pending)
+        {
+            Timer* t = pending.next;
+            t->unlink();
+            insert(*t);
+        }
+    }
+
+    long long now;
+    Timer slots[LEVELS][SLOTS];
+};
+
+#endif // TIMERWHEEL_H_
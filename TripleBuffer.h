@@ -0,0 +1,64 @@
+#ifndef TRIPLEBUFFER_H_
+#define TRIPLEBUFFER_H_
+
+#include <atomic>
+
+// Hands the latest of a stream of values from one writing thread to one
+// reading thread without either ever waiting for the other. The writer
+// fills its own buffer and publishes it by swapping it with the spare
+// one; the reader takes the spare one in exchange for its own whenever a
+// newer value has been published since it last looked. Values the reader
+// never got around to are simply overwritten. Buffers are reused, so a
+// value's members keep their capacity from one use to the next.
+template<typename T>
+class TripleBuffer
+{
+public:
+    TripleBuffer()
+    : spare(1), back(0), front(2)
+    {}
+
+    // The buffer the writer fills next; it still holds whatever was
+    // written to it three or more publishes ago
+    T& writeBuffer()
+    {
+        return buffers[back];
+    }
+
+    // Makes the write buffer the newest value and hands the writer another
+    void publish()
+    {
+        back = spare.exchange(back | FRESH, std::memory_order_acq_rel) & INDEX;
+    }
+
+    // Takes the newest value if one was published since the last call,
+    // returning true if so
+    bool update()
+    {
+        if((spare.load(std::memory_order_relaxed) & FRESH) == 0)
+            return false;
+        front = spare.exchange(front, std::memory_order_acq_rel) & INDEX;
+        return true;
+    }
+
+    // The newest value the reader has taken
+    const T& readBuffer() const
+    {
+        return buffers[front];
+    }
+
+    // Prevent copying or assigning TripleBuffers
+    TripleBuffer(const TripleBuffer&) = delete;
+    TripleBuffer& operator=(const TripleBuffer&) = delete;
+
+private:
+    static const int INDEX = 3;
+    static const int FRESH = 4;     // set in spare when it holds an unread value
+
+    T buffers[3];
+    std::atomic<int> spare;         // index of the spare buffer, plus FRESH
+    int back;                       // the writer's buffer
+    int front;                      // the reader's buffer
+};
+
+#endif // TRIPLEBUFFER_H_
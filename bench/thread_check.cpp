@@ -0,0 +1,106 @@
+// Plays the same seeded game headless with one thread and with several,
+// feeding both the same keys, and checks that they end in the same state.
+// Agents decide on any thread but their moves are committed in schedule
+// order, so the number of threads must never change how a game plays
+// out. Each dispatch mode is checked. Build from the top directory with
+// the rest of the game, e.g.
+//
+//     g++ -std=c++17 -O2 -I. $(ls *.cpp | grep -v main.cpp) bench/thread_check.cpp -o thread_check -pthread -lglut -lGLU -lGL
+//
+// and run it as
+//
+//     ./thread_check ASSETS [SEED [TICKS [THREADS]]]
+//
+// It exits with status 1 if any two runs end differently.
+
+#include "GameController.h"
+#include "GameWorld.h"
+#include "GameConstants.h"
+#include "InputQueue.h"
+#include <string>
+#include <random>
+#include <iostream>
+#include <sstream>
+#include <cstdio>
+#include <cstdlib>
+using namespace std;
+
+GameWorld* createStudentWorld(string assetPath);
+
+static const char* KEYS_FILE = "thread_check.keys";
+
+// writes keys for about one tick in three, as a recording -replay reads
+static bool writeKeys(unsigned int seed, int ticks)
+{
+    static const int keys[] = {
+        KEY_PRESS_LEFT, KEY_PRESS_RIGHT, KEY_PRESS_UP, KEY_PRESS_DOWN,
+        KEY_PRESS_SPACE, KEY_PRESS_TAB, KEY_PRESS_ENTER
+    };
+    PlaySettings settings;
+    settings.seed = seed;
+    InputLog log;
+    if(!log.record(KEYS_FILE, settings))
+        return false;
+    mt19937 rng(seed);
+    for(int tick = 0; tick < ticks; tick++)
+    {
+        if(rng() % 3 == 0)
+            log.add(tick, keys[rng() % (sizeof(keys) / sizeof(keys[0]))]);
+    }
+    return true;
+}
+
+// plays the recorded game and returns the state it ends in; the game's
+// own reports are thrown away
+static unsigned long long play(const string& assets, int ticks, int threads, bool typed)
+{
+    PlaySettings settings;
+    if(!Game().replayInput(KEYS_FILE, settings))
+        return 0;
+    GameWorld* gw = createStudentWorld(assets);
+    gw->setRandomSeed(settings.seed);
+    gw->setResortPeriod(settings.resortPeriod);
+    gw->setWorkerThreads(threads);
+    gw->setTypedDispatch(typed);
+
+    ostringstream discard;
+    streambuf* out = cout.rdbuf(discard.rdbuf());
+    streambuf* err = cerr.rdbuf(discard.rdbuf());
+    Game().runHeadless(gw, ticks);
+    cout.rdbuf(out);
+    cerr.rdbuf(err);
+    return Game().getStateHash();
+}
+
+int main(int argc, char* argv[])
+{
+    if(argc < 2)
+    {
+        cout << "usage: " << argv[0] << " ASSETS [SEED [TICKS [THREADS]]]" << endl;
+        return 1;
+    }
+    string assets = string(argv[1]) + "/";
+    unsigned int seed = (argc > 2 ? static_cast<unsigned int>(strtoul(argv[2], nullptr, 10)) : 1);
+    int ticks = (argc > 3 ? atoi(argv[3]) : 3000);
+    int threads = (argc > 4 ? atoi(argv[4]) : 4);
+
+    if(!writeKeys(seed, ticks))
+    {
+        cout << "Cannot write " << KEYS_FILE << endl;
+        return 1;
+    }
+
+    bool same = true;
+    for(int typed = 0; typed <= 1; typed++)
+    {
+        unsigned long long one = play(assets, ticks, 1, typed != 0);
+        unsigned long long many = play(assets, ticks, threads, typed != 0);
+        cout << (typed ? "typed dispatch:   " : "virtual dispatch: ")
+             << "1 thread " << hex << one << ", " << dec << threads << " threads " << hex << many << dec
+             << (one == many ? "" : "  DIFFERENT") << endl;
+        if(one != many)
+            same = false;
+    }
+    remove(KEYS_FILE);
+    return same ? 0 : 1;
+}
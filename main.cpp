@@ -1,7 +1,12 @@
 #include "GameController.h"
+#include "GameWorld.h"
+#include "AllocationTracker.h"
 #include <iostream>
 #include <fstream>
 #include <string>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
 using namespace std;
 
 #ifdef _MSC_VER
@@ -30,8 +35,81 @@ class GameWorld;
 
 GameWorld* createStudentWorld(string assetPath = "");
 
+  // Options we understand are taken out of argv before GLUT sees it:
+  //   -seed N      seed the world's random choices so runs can be repeated
+  //   -threads N   spread each tick's work over N threads; by default a
+  //                headless run uses every core and a windowed game half
+  //                of them, leaving the rest to drawing and sound
+  //   -headless N  play N ticks without a window and print the outcome
+  //   -typed       keep actors in per-type lists and dispatch on those
+  //   -resort N    re-sort actors by position every N ticks, or sooner
+  //                when they have scattered
+  //   -tickrate N  play N ticks a second in a window, easing sprites
+  //                between ticks as the window is redrawn; a headless run
+  //                plays as fast as it can but mixes sound at this rate
+  //   -sound WHERE mix sounds in the process and send them to WHERE: null
+  //                to throw them away, or a file to record them as a WAV;
+  //                works headless too
+  //   -record FILE write the keys the game acts on, tick by tick, to FILE
+  //   -replay FILE play the keys recorded in FILE instead of the keyboard's,
+  //                with the seed and -resort they were recorded with, in
+  //                place of any given here, so the recorded game plays
+  //                out again exactly; works headless too
+  //   -allocbudget N  fail a headless run on any tick making more than N
+  //                heap allocations; needs a build with TRACK_ALLOCATIONS
+  //                defined, which also reports allocations at the end
+  //
+  // Searches for the nearest actor use AVX2 or SSE4.1 only in a build
+  // that targets them, e.g. with -mavx2 or -march=native on GCC and Clang
+  // or /arch:AVX2 on MSVC; other builds use plain loops, with the same
+  // results. bench/nearest_bench says which one a set of flags gets.
+
 int main(int argc, char* argv[])
 {
+    bool haveSeed = false;
+    unsigned int seed = 0;
+    int threads = 0;
+    int headlessTicks = 0;
+    bool typed = false;
+    int resortPeriod = 0;
+    long long allocBudget = -1;
+    int tickRate = 0;
+    string soundSink;
+    string recordFile;
+    string replayFile;
+
+    int kept = 1;
+    for (int i = 1; i < argc; i++)
+    {
+        if (i+1 < argc  &&  strcmp(argv[i], "-seed") == 0)
+        {
+            haveSeed = true;
+            seed = static_cast<unsigned int>(strtoul(argv[++i], nullptr, 10));
+        }
+        else if (i+1 < argc  &&  strcmp(argv[i], "-threads") == 0)
+            threads = atoi(argv[++i]);
+        else if (i+1 < argc  &&  strcmp(argv[i], "-headless") == 0)
+            headlessTicks = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-typed") == 0)
+            typed = true;
+        else if (i+1 < argc  &&  strcmp(argv[i], "-resort") == 0)
+            resortPeriod = atoi(argv[++i]);
+        else if (i+1 < argc  &&  strcmp(argv[i], "-tickrate") == 0)
+            tickRate = atoi(argv[++i]);
+        else if (i+1 < argc  &&  strcmp(argv[i], "-allocbudget") == 0)
+            allocBudget = atoll(argv[++i]);
+        else if (i+1 < argc  &&  strcmp(argv[i], "-sound") == 0)
+            soundSink = argv[++i];
+        else if (i+1 < argc  &&  strcmp(argv[i], "-record") == 0)
+            recordFile = argv[++i];
+        else if (i+1 < argc  &&  strcmp(argv[i], "-replay") == 0)
+            replayFile = argv[++i];
+        else
+            argv[kept++] = argv[i];
+    }
+    argc = kept;
+    argv[argc] = nullptr;
+
     string assetPath = assetDirectory;
     if (!assetPath.empty())
     {
@@ -53,6 +131,62 @@ int main(int argc, char* argv[])
         }
     }
 
+    if (soundSink == "null")
+        Game().setSoundSink(unique_ptr<AudioSink>(new NullSink));
+    else if (!soundSink.empty())
+    {
+        unique_ptr<WavFileSink> file(new WavFileSink(soundSink, AudioMixer::RATE));
+        if (!file->isOpen())
+        {
+            cout << "Cannot write " << soundSink << endl;
+            return 1;
+        }
+        Game().setSoundSink(move(file));
+    }
+
+    if (!replayFile.empty())
+    {
+        PlaySettings recorded;
+        if (!Game().replayInput(replayFile, recorded))
+        {
+            cout << "Cannot read a recording of input from " << replayFile << endl;
+            return 1;
+        }
+        seed = recorded.seed;
+        haveSeed = true;
+        resortPeriod = recorded.resortPeriod;
+    }
+
     GameWorld* gw = createStudentWorld(assetPath);
+    if (haveSeed)
+        gw->setRandomSeed(seed);
+    if (!recordFile.empty())
+    {
+        PlaySettings settings;
+        settings.seed = gw->getRandomSeed();
+        settings.resortPeriod = resortPeriod;
+        if (!Game().recordInput(recordFile, settings))
+        {
+            cout << "Cannot write " << recordFile << endl;
+            return 1;
+        }
+    }
+    if (threads <= 0)
+    {
+        int cores = static_cast<int>(thread::hardware_concurrency());
+        threads = (headlessTicks > 0 ? cores : cores / 2);
+    }
+    gw->setWorkerThreads(threads);
+    gw->setTypedDispatch(typed);
+    gw->setResortPeriod(resortPeriod);
+
+    if (allocBudget >= 0  &&  !AllocationTracker::enabled())
+        cout << "Allocation tracking is off; build with TRACK_ALLOCATIONS defined" << endl;
+    AllocationTracker::setTickBudget(allocBudget);
+
+    Game().setTicksPerSecond(tickRate);
+    if (headlessTicks > 0)
+        return Game().runHeadless(gw, headlessTicks) ? 0 : 1;
+
     Game().run(argc, argv, gw, "Zombie Dash");
 }